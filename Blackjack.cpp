@@ -0,0 +1,235 @@
+#include "Blackjack.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+int GetCardCode(Card c) {
+	return c.value * 4 + c.suit;
+}
+
+Card CardFromCode(int code) {
+	Card out;
+	out.value = (Value)(code / 4);
+	out.suit = (Suit)(code % 4);
+	return out;
+}
+
+// splitmix64 spreads any seed, even 0 or 1, over the whole state
+void SeedRng(Rng& rng, uint64_t seed) {
+	for (int i = 0; i < 4; i += 2) {
+		seed += 0x9E3779B97F4A7C15ull;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z = z ^ (z >> 31);
+		rng.s[i] = (uint32_t)z;
+		rng.s[i + 1] = (uint32_t)(z >> 32);
+	}
+}
+
+static inline uint32_t RotateLeft(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+uint32_t NextRandom(Rng& rng) {
+	uint32_t* s = rng.s;
+	uint32_t result = RotateLeft(s[1] * 5, 7) * 9;
+	uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = RotateLeft(s[3], 11);
+	return result;
+}
+
+int RandInRange(Rng& rng, int low, int high) {
+	uint32_t range = (uint32_t)(high - low + 1);
+	// scale instead of %: no division. Without a rejection step some results come up one
+	// time more than others in 2^32, which is far below anything a simulation can see, and
+	// BulkShuffle relies on matching this exactly
+	return low + (int)(((uint64_t)NextRandom(rng) * range) >> 32);
+}
+
+void FillDeck(Deck& deck) {
+	FillShoe(deck, 1);
+}
+
+void FillShoe(Deck& deck, int num_decks) {
+	if (num_decks < 1)
+		num_decks = 1;
+	if (num_decks > MAX_DECKS)
+		num_decks = MAX_DECKS;
+	int slot = 0;
+	for (int d = 0; d < num_decks; d++) {
+		for (int value = 0; value < 13; value++) {
+			for (int suit = 0; suit < 4; suit++) {
+				deck.cards[slot].value = (Value)value;
+				deck.cards[slot].suit = (Suit)suit;
+				slot++;
+			}
+		}
+	}
+	deck.num_cards = slot;
+	deck.next_card = 0;
+	deck.round_start = 0;
+	// RAND_MAX can be as small as 15 bits
+	uint64_t seed = 0;
+	for (int i = 0; i < 4; i++)
+		seed = (seed << 16) ^ (uint64_t)rand();
+	SeedRng(deck.rng, seed);
+}
+
+void SeedDeck(Deck& deck, uint64_t seed) {
+	SeedRng(deck.rng, seed);
+}
+
+void PrintDeck(const Deck& deck) {
+	char buffer[32];
+	for (int i = 0; i < deck.num_cards; i++)
+		cout << FormatCard(buffer, sizeof(buffer), deck.cards[i]) << '\n';
+	cout.flush();
+}
+
+// Fisher-Yates on the cards from first on
+static void ShuffleCards(Deck& deck, int first) {
+	for (int i = first; i < deck.num_cards; i++) {
+		int j = RandInRange(deck.rng, i, deck.num_cards - 1);
+		Card temp = deck.cards[i];
+		deck.cards[i] = deck.cards[j];
+		deck.cards[j] = temp;
+	}
+}
+
+void ShuffleDeck(Deck& deck) {
+	ShuffleCards(deck, 0);
+	deck.next_card = 0;
+	deck.round_start = 0;
+}
+
+Card DealCard(Deck& deck) {
+	// splits can eat through a whole deck; the cards in play move to the front and the
+	// discards are shuffled in behind them, so nothing still on the table is dealt twice
+	if (deck.next_card >= deck.num_cards) {
+		int in_play = deck.num_cards - deck.round_start;
+		if (in_play >= deck.num_cards)
+			ShuffleDeck(deck);		// the round has every card out; there are no discards
+		else {
+			std::rotate(deck.cards, deck.cards + deck.round_start, deck.cards + deck.num_cards);
+			ShuffleCards(deck, in_play);
+			deck.next_card = in_play;
+			deck.round_start = 0;
+		}
+	}
+	Card out = deck.cards[deck.next_card];
+	deck.next_card++;
+	return out;
+}
+
+
+void InitializeHand(Hand& cs) {
+	// what would be good starting values for each member of the struct?
+	cs.num_cards = 0;
+}
+
+void AddCardToHand(Hand& cs, Card cardToAdd) {
+	// what needs to happen when we add a card to a card stack?
+	cs.cards[cs.num_cards] = cardToAdd;
+	cs.num_cards++;
+
+}
+
+int GetCardPoints(Card c) {
+	switch (c.value) {
+	case Ace:
+		return 11;
+	case Jack:
+	case Queen:
+	case King:
+		return 10;
+	default:
+		return 1 + c.value;
+	}
+}
+
+// counts the hand, and how many aces are still worth 11 once it's been brought under 22
+static int CountPoints(const Hand& hand, int& soft_aces) {
+	int points = 0;
+	int ace_count = 0;
+	for (int i = 0; i < hand.num_cards; i++) {
+		Card c = hand.cards[i];
+		points += GetCardPoints(c);
+		if (c.value == Ace)
+			ace_count++;
+	}
+	while (points > 21 && ace_count > 0) {
+		points -= 10;
+		ace_count--;
+	}
+	soft_aces = ace_count;
+	return points;
+}
+
+int GetPoints(const Hand& hand) {
+	int soft_aces;
+	return CountPoints(hand, soft_aces);
+}
+
+bool IsSoft(const Hand& hand) {
+	int soft_aces;
+	CountPoints(hand, soft_aces);
+	return soft_aces > 0;
+}
+
+bool IsBlackjack(const Hand& hand) {
+	return hand.num_cards == 2 && GetPoints(hand) == 21;
+}
+
+/* TEXT */
+
+void AppendCard(TextBuffer& text, Card c) {
+	AppendText(text, ValueStrings[c.value]);
+	AppendText(text, " of ");
+	AppendText(text, SuitStrings[c.suit]);
+}
+
+void AppendShortCard(TextBuffer& text, Card c) {
+	AppendChar(text, ValueLetters[c.value]);
+	AppendChar(text, SuitLetters[c.suit]);
+}
+
+void AppendHand(TextBuffer& text, const Hand& hand) {
+	for (int i = 0; i < hand.num_cards; i++) {
+		AppendShortCard(text, hand.cards[i]);
+		AppendChar(text, ' ');
+	}
+	AppendText(text, "= ");
+	if (IsBlackjack(hand)) {
+		AppendText(text, "blackjack");
+		return;
+	}
+	int points = GetPoints(hand);
+	if (IsSoft(hand))
+		AppendText(text, "soft ");
+	AppendInt(text, points);
+	if (points > 21)
+		AppendText(text, " bust");
+}
+
+string_view FormatCard(char* buffer, int size, Card c) {
+	TextBuffer text;
+	InitializeText(text, buffer, size);
+	AppendCard(text, c);
+	return GetText(text);
+}
+
+string_view FormatHand(char* buffer, int size, const Hand& hand) {
+	TextBuffer text;
+	InitializeText(text, buffer, size);
+	AppendHand(text, hand);
+	return GetText(text);
+}
@@ -0,0 +1,89 @@
+#ifndef BLACKJACK_H
+#define BLACKJACK_H
+
+/* Cards, decks and hands. Nothing in here knows about SDL, so the simulator
+* and anything else that just wants to play blackjack can use it too.
+*/
+
+#include "Format.h"
+
+#include <cstdint>
+#include <string_view>
+
+/* ENUM, ARRAY AND STRUCT DEFINITIONS */
+
+enum GameState { InsuranceOffer, PlayerTurn, DealerTurn, GameOver };
+
+enum Suit : uint8_t { Clubs, Diamonds, Hearts, Spades };
+inline constexpr std::string_view SuitStrings[] = { "Clubs", "Diamonds", "Hearts", "Spades" };
+inline constexpr char SuitLetters[] = "cdhs";
+
+enum   Value : uint8_t  {
+	Ace, Two, Three, Four, Five, Six, Seven, Eight, Nine,
+	Ten, Jack, Queen, King
+};
+inline constexpr std::string_view ValueStrings[] = { "Ace", "Two", "Three", "Four", "Five", "Six", "Seven",
+"Eight", "Nine", "Ten", "Jack", "Queen", "King" };
+inline constexpr char ValueLetters[] = "A23456789TJQK";
+
+struct Card {
+	Value  value;
+	Suit   suit;
+};
+
+/* Every deck carries its own random number generator (xoshiro128**), so decks
+* on different threads never share state the way they would with rand().
+*/
+
+struct Rng {
+	uint32_t s[4];
+};
+
+#define MAX_DECKS 8		// most decks a shoe can hold
+
+struct Deck {
+	Card cards[MAX_DECKS * 52];
+	int num_cards;		// 52 per deck
+	int next_card;
+	int round_start;	// where this round's cards begin; the ones before it are discards
+	Rng rng;
+};
+
+/* Hand represents a pile of cards */
+
+struct Hand {
+	int num_cards;
+	Card cards[52];	// holds UP TO 52 cards
+};
+
+/* FUNCTIONS */
+
+int GetCardCode(Card c);
+Card CardFromCode(int code);
+void SeedRng(Rng& rng, uint64_t seed);
+uint32_t NextRandom(Rng& rng);
+int RandInRange(Rng& rng, int low, int high);
+
+void FillDeck(Deck& deck);		// also seeds the deck from rand()
+void FillShoe(Deck& deck, int num_decks);	// FillDeck with num_decks decks one after another
+void SeedDeck(Deck& deck, uint64_t seed);
+void PrintDeck(const Deck& deck);
+void ShuffleDeck(Deck& deck);
+// runs out mid-round: shuffles the discards back in, leaving the cards in play alone
+Card DealCard(Deck& deck);
+
+void InitializeHand(Hand& cs);
+void AddCardToHand(Hand& cs, Card cardToAdd);
+int GetCardPoints(Card c);			// aces count 11 here
+int GetPoints(const Hand& hand);
+bool IsSoft(const Hand& hand);		// is an ace still being counted as 11?
+bool IsBlackjack(const Hand& hand);
+
+/* TEXT (see Format.h) */
+
+void AppendCard(TextBuffer& text, Card c);			// "Ace of Spades"
+void AppendShortCard(TextBuffer& text, Card c);		// "As"
+void AppendHand(TextBuffer& text, const Hand& hand);	// "As 6d = soft 17", "Td 7c 9h = 26 bust"
+std::string_view FormatCard(char* buffer, int size, Card c);
+std::string_view FormatHand(char* buffer, int size, const Hand& hand);
+#endif
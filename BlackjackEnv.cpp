@@ -0,0 +1,217 @@
+#include "BlackjackEnv.h"
+
+#include "Blackjack.h"
+#include "Rules.h"
+#include "Simulator.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#define TABLES_PER_THREAD 2048	// below this a batch isn't worth waking another thread for
+
+static_assert(BJ_STATE_INSURANCE_OFFER == InsuranceOffer && BJ_STATE_PLAYER_TURN == PlayerTurn &&
+	BJ_STATE_GAME_OVER == GameOver, "BJ_STATE_* must match GameState");
+static_assert(BJ_ACTION_HIT == Hit && BJ_ACTION_STAND == Stand && BJ_ACTION_DOUBLE == Double &&
+	BJ_ACTION_SPLIT == Split && BJ_ACTION_SURRENDER == Surrender, "BJ_ACTION_* must match Action");
+
+struct EnvTable {
+	Deck	deck;
+	Round	round;
+};
+
+struct BJ_Env {
+	int						num_tables;
+	int						rules;
+	std::vector<EnvTable>	tables;
+
+	// the batch being worked on; written before the workers are woken up
+	bool					resetting;
+	const int32_t*			actions;
+	int32_t*				observations;
+	float*					rewards;
+	uint8_t*				dones;
+
+	// the worker pool: bumping generation starts a batch, busy counts down to 0 as slices finish
+	std::vector<std::thread>	workers;
+	std::mutex					lock;
+	std::condition_variable		wake;
+	std::condition_variable		finished;
+	int							generation;
+	int							busy;
+	bool						quit;
+};
+
+template <class Rules>
+static void Deal(EnvTable& table) {
+	if (table.deck.next_card >= (int)(DEFAULT_PENETRATION * table.deck.num_cards))
+		ShuffleDeck(table.deck);
+	StartRound<Rules>(table.round, table.deck, 1.0);
+}
+
+template <class Rules>
+static void Observe(const EnvTable& table, int32_t* obs) {
+	const Round& round = table.round;
+	const Hand& hand = round.hands[round.current].cards;
+	obs[BJ_OBS_POINTS] = GetPoints(hand);
+	obs[BJ_OBS_SOFT] = IsSoft(hand);
+	obs[BJ_OBS_DEALER_UPCARD] = GetCardPoints(round.dealer.cards[0]);
+	obs[BJ_OBS_CAN_DOUBLE] = CanDouble<Rules>(round);
+	obs[BJ_OBS_CAN_SPLIT] = CanSplit<Rules>(round);
+	obs[BJ_OBS_CAN_SURRENDER] = CanSurrender<Rules>(round);
+	obs[BJ_OBS_STATE] = round.state;
+	obs[BJ_OBS_HAND_INDEX] = round.current;
+	obs[BJ_OBS_NUM_HANDS] = round.num_hands;
+	obs[BJ_OBS_CARDS_DEALT] = table.deck.next_card;
+}
+
+template <class Rules>
+static void StepTable(EnvTable& table, int32_t action, int32_t* obs, float* reward, uint8_t* done) {
+	Round& round = table.round;
+	if (round.state == InsuranceOffer)
+		TakeInsurance<Rules>(round, action == BJ_ACTION_INSURE);
+	else if (round.state == PlayerTurn) {
+		if (action < Hit || action > Surrender || !ApplyAction<Rules>(round, table.deck, (Action)action))
+			ApplyAction<Rules>(round, table.deck, Stand);
+	}
+	if (round.state == DealerTurn)
+		PlayDealer<Rules>(round, table.deck);
+	if (round.state == GameOver) {
+		*reward = (float)SettleRound<Rules>(round);
+		*done = 1;
+		Deal<Rules>(table);
+	}
+	else {
+		*reward = 0;
+		*done = 0;
+	}
+	Observe<Rules>(table, obs);
+}
+
+template <class Rules>
+static void RunTables(BJ_Env* env, int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		int32_t* obs = env->observations + i * BJ_OBSERVATION_SIZE;
+		if (env->resetting) {
+			Deal<Rules>(env->tables[i]);
+			Observe<Rules>(env->tables[i], obs);
+		}
+		else StepTable<Rules>(env->tables[i], env->actions[i], obs, env->rewards + i, env->dones + i);
+	}
+}
+
+// the rule set is picked once per slice, so the per-table loop is specialized for it
+static void RunSlice(BJ_Env* env, int slice) {
+	int num_slices = (int)env->workers.size() + 1;
+	int begin = (int)((long long)env->num_tables * slice / num_slices);
+	int end = (int)((long long)env->num_tables * (slice + 1) / num_slices);
+	switch (env->rules) {
+	case BJ_RULES_STANDARD: RunTables<StandardRules>(env, begin, end); break;
+	case BJ_RULES_H17: RunTables<H17Rules>(env, begin, end); break;
+	case BJ_RULES_SIX_TO_FIVE: RunTables<SixToFiveRules>(env, begin, end); break;
+	case BJ_RULES_NO_FRILLS: RunTables<NoFrillsRules>(env, begin, end); break;
+	}
+}
+
+static void WorkerLoop(BJ_Env* env, int slice) {
+	int seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(env->lock);
+			env->wake.wait(guard, [&] { return env->quit || env->generation != seen; });
+			if (env->quit)
+				return;
+			seen = env->generation;
+		}
+		RunSlice(env, slice);
+		std::lock_guard<std::mutex> guard(env->lock);
+		if (--env->busy == 0)
+			env->finished.notify_one();
+	}
+}
+
+// the calling thread takes slice 0 and waits for the workers to finish the rest
+static void RunBatch(BJ_Env* env) {
+	if (env->workers.empty()) {
+		RunSlice(env, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(env->lock);
+		env->busy = (int)env->workers.size();
+		env->generation++;
+	}
+	env->wake.notify_all();
+	RunSlice(env, 0);
+	std::unique_lock<std::mutex> guard(env->lock);
+	env->finished.wait(guard, [&] { return env->busy == 0; });
+}
+
+BJ_Env* BJ_CreateEnv(int num_tables, int rules, uint64_t seed, int num_threads) {
+	if (num_tables <= 0 || rules < BJ_RULES_STANDARD || rules > BJ_RULES_NO_FRILLS || num_threads < 0)
+		return NULL;
+	if (num_threads == 0) {
+		num_threads = (int)std::thread::hardware_concurrency();
+		if (num_threads > num_tables / TABLES_PER_THREAD)
+			num_threads = num_tables / TABLES_PER_THREAD;
+	}
+	if (num_threads > num_tables)
+		num_threads = num_tables;
+	if (num_threads < 1)
+		num_threads = 1;
+
+	BJ_Env* env = new BJ_Env;
+	env->num_tables = num_tables;
+	env->rules = rules;
+	env->tables.resize(num_tables);
+	for (int i = 0; i < num_tables; i++) {
+		FillDeck(env->tables[i].deck);
+		SeedDeck(env->tables[i].deck, seed + i);
+		ShuffleDeck(env->tables[i].deck);
+	}
+	env->resetting = false;
+	env->actions = NULL;
+	env->observations = NULL;
+	env->rewards = NULL;
+	env->dones = NULL;
+	env->generation = 0;
+	env->busy = 0;
+	env->quit = false;
+	for (int i = 1; i < num_threads; i++)
+		env->workers.push_back(std::thread(WorkerLoop, env, i));
+	return env;
+}
+
+void BJ_DestroyEnv(BJ_Env* env) {
+	if (env == NULL)
+		return;
+	{
+		std::lock_guard<std::mutex> guard(env->lock);
+		env->quit = true;
+	}
+	env->wake.notify_all();
+	for (size_t i = 0; i < env->workers.size(); i++)
+		env->workers[i].join();
+	delete env;
+}
+
+int BJ_GetNumTables(const BJ_Env* env) {
+	return env->num_tables;
+}
+
+void BJ_ResetEnv(BJ_Env* env, int32_t* observations) {
+	env->resetting = true;
+	env->observations = observations;
+	RunBatch(env);
+}
+
+void BJ_StepEnv(BJ_Env* env, const int32_t* actions, int32_t* observations,
+	float* rewards, uint8_t* dones) {
+	env->resetting = false;
+	env->actions = actions;
+	env->observations = observations;
+	env->rewards = rewards;
+	env->dones = dones;
+	RunBatch(env);
+}
@@ -0,0 +1,81 @@
+#ifndef BLACKJACK_ENV_H
+#define BLACKJACK_ENV_H
+
+/* A C interface to the game engine for training agents, built as blackjackenv.dll.
+*
+* One environment holds num_tables independent tables. BJ_StepEnv takes one action
+* per table and writes every table's observation, reward and done flag straight into
+* the caller's arrays: nothing is allocated or copied per step, so these can be numpy
+* buffers or whatever the trainer already has. Big batches are split across threads.
+*
+* Each round is one episode. When a round ends, that step's reward is the chips the
+* round won or lost (betting 1), done is 1, and the table has already been dealt its
+* next round, which is what the observation describes. A round can be decided on the
+* deal (a natural); its observation has state BJ_STATE_GAME_OVER, and the next step
+* pays it out whatever the action.
+*/
+
+#include <stdint.h>
+
+#if !defined(_WIN32)
+#define BJ_API __attribute__((visibility("default")))
+#elif defined(BLACKJACKENV_EXPORTS)
+#define BJ_API __declspec(dllexport)
+#else
+#define BJ_API __declspec(dllimport)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* rule sets, see Rules.h */
+#define BJ_RULES_STANDARD		0
+#define BJ_RULES_H17			1
+#define BJ_RULES_SIX_TO_FIVE	2
+#define BJ_RULES_NO_FRILLS		3
+
+/* actions; an action that isn't allowed right now is played as a stand */
+#define BJ_ACTION_HIT			0
+#define BJ_ACTION_STAND			1
+#define BJ_ACTION_DOUBLE		2
+#define BJ_ACTION_SPLIT			3
+#define BJ_ACTION_SURRENDER		4
+#define BJ_ACTION_INSURE		5	/* only means something in BJ_STATE_INSURANCE_OFFER; anything else declines */
+
+/* each table's observation is BJ_OBSERVATION_SIZE int32s, in this order: */
+#define BJ_OBS_POINTS			0	/* the current hand's total */
+#define BJ_OBS_SOFT				1	/* 1 if an ace in it still counts 11 */
+#define BJ_OBS_DEALER_UPCARD	2	/* 2 to 11 */
+#define BJ_OBS_CAN_DOUBLE		3
+#define BJ_OBS_CAN_SPLIT		4
+#define BJ_OBS_CAN_SURRENDER	5
+#define BJ_OBS_STATE			6	/* one of BJ_STATE_* */
+#define BJ_OBS_HAND_INDEX		7	/* which split hand is being played */
+#define BJ_OBS_NUM_HANDS		8
+#define BJ_OBS_CARDS_DEALT		9	/* cards gone since the last shuffle */
+#define BJ_OBSERVATION_SIZE		10
+
+#define BJ_STATE_INSURANCE_OFFER	0
+#define BJ_STATE_PLAYER_TURN		1
+#define BJ_STATE_GAME_OVER			3
+
+typedef struct BJ_Env BJ_Env;
+
+/* table i's deck is seeded with seed + i. num_threads 0 picks based on num_tables.
+* returns NULL if the arguments don't make sense */
+BJ_API BJ_Env* BJ_CreateEnv(int num_tables, int rules, uint64_t seed, int num_threads);
+BJ_API void BJ_DestroyEnv(BJ_Env* env);
+BJ_API int BJ_GetNumTables(const BJ_Env* env);
+
+/* deals every table a fresh round; observations holds num_tables * BJ_OBSERVATION_SIZE */
+BJ_API void BJ_ResetEnv(BJ_Env* env, int32_t* observations);
+
+/* actions, rewards and dones hold num_tables each */
+BJ_API void BJ_StepEnv(BJ_Env* env, const int32_t* actions, int32_t* observations,
+	float* rewards, uint8_t* dones);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,161 @@
+#include "BulkShuffle.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// x86 builds get SSE2 by default, everything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BULK_SHUFFLE_SSE2
+#include <emmintrin.h>
+#endif
+
+// a shoe in FillShoe order: card codes 0 to 51, once per deck
+static void FillCodes(uint8_t* shoe, int num_cards) {
+	for (int i = 0; i < DECK_BYTES; i++)
+		shoe[i] = (uint8_t)i;
+	for (int i = DECK_BYTES; i < num_cards; i += DECK_BYTES)
+		memcpy(shoe + i, shoe, DECK_BYTES);
+}
+
+// the plain Fisher-Yates that ShuffleDeck does, on card codes; mirrored turns every
+// random number r into ~r, so each swap reaches from the other end of what's left
+static void ShuffleOne(uint8_t* deck, int num_cards, uint64_t seed, bool mirrored = false) {
+	Rng rng;
+	SeedRng(rng, seed);
+	FillCodes(deck, num_cards);
+	for (int i = 0; i < num_cards; i++) {
+		uint32_t random = NextRandom(rng);
+		if (mirrored)
+			random = ~random;
+		int j = i + (int)(((uint64_t)random * (uint32_t)(num_cards - i)) >> 32);
+		uint8_t temp = deck[i];
+		deck[i] = deck[j];
+		deck[j] = temp;
+	}
+}
+
+#ifdef BULK_SHUFFLE_SSE2
+
+static inline __m128i RotateLeft(__m128i x, int k) {
+	return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+}
+
+// four decks at a time: lane k of each register is deck k's xoshiro128** state, and
+// one pass makes the random number for the same position in all four decks.
+// Fixed is the card count when it's known up front, which lets the loops unroll
+template <int Fixed>
+static void ShuffleFour(uint8_t* decks, int num_cards, uint64_t seed) {
+	if (Fixed > 0)
+		num_cards = Fixed;
+	alignas(16) uint32_t state[4][4];	// [word][lane]
+	for (int lane = 0; lane < 4; lane++) {
+		Rng rng;
+		SeedRng(rng, seed + lane);
+		for (int w = 0; w < 4; w++)
+			state[w][lane] = rng.s[w];
+	}
+	__m128i s0 = _mm_load_si128((const __m128i*)state[0]);
+	__m128i s1 = _mm_load_si128((const __m128i*)state[1]);
+	__m128i s2 = _mm_load_si128((const __m128i*)state[2]);
+	__m128i s3 = _mm_load_si128((const __m128i*)state[3]);
+	const __m128i high_words = _mm_set_epi32(-1, 0, -1, 0);
+
+	for (int lane = 0; lane < 4; lane++)
+		FillCodes(decks + lane * num_cards, num_cards);
+	alignas(16) uint32_t picks[4];
+	for (int i = 0; i < num_cards; i++) {
+		// result = rotl(s1 * 5, 7) * 9, with the multiplies done as shift and add
+		__m128i x = _mm_add_epi32(_mm_slli_epi32(s1, 2), s1);
+		x = RotateLeft(x, 7);
+		__m128i random = _mm_add_epi32(_mm_slli_epi32(x, 3), x);
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = RotateLeft(s3, 11);
+
+		// (random * range) >> 32 per lane, same as RandInRange; SSE2 only multiplies
+		// the even lanes, so the odd ones get shifted down for a second multiply
+		__m128i range = _mm_set1_epi32(num_cards - i);
+		__m128i even = _mm_srli_epi64(_mm_mul_epu32(random, range), 32);
+		__m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(random, 32), range), high_words);
+		_mm_store_si128((__m128i*)picks, _mm_or_si128(even, odd));
+
+		for (int lane = 0; lane < 4; lane++) {
+			uint8_t* deck = decks + lane * num_cards;
+			int j = i + (int)picks[lane];
+			uint8_t temp = deck[i];
+			deck[i] = deck[j];
+			deck[j] = temp;
+		}
+	}
+}
+
+#endif
+
+static void ShuffleRange(uint8_t* decks, int num_cards, long long first, long long count, uint64_t seed) {
+	long long d = 0;
+#ifdef BULK_SHUFFLE_SSE2
+	for (; d + 4 <= count; d += 4) {
+		// single decks are by far the common case
+		if (num_cards == DECK_BYTES)
+			ShuffleFour<DECK_BYTES>(decks + (first + d) * num_cards, num_cards, seed + first + d);
+		else ShuffleFour<0>(decks + (first + d) * num_cards, num_cards, seed + first + d);
+	}
+#endif
+	for (; d < count; d++)
+		ShuffleOne(decks + (first + d) * num_cards, num_cards, seed + first + d);
+}
+
+void ShuffleDecks(uint8_t* decks, long long num_decks, uint64_t seed, int num_threads) {
+	ShuffleShoes(decks, num_decks, 1, seed, num_threads);
+}
+
+void ShuffleShoes(uint8_t* shoes, long long num_shoes, int decks_per_shoe, uint64_t seed, int num_threads) {
+	int num_cards = DECK_BYTES * decks_per_shoe;
+	if (num_threads <= 1 || num_shoes < 4 * num_threads) {
+		ShuffleRange(shoes, num_cards, 0, num_shoes, seed);
+		return;
+	}
+	// ranges are multiples of four shoes, so every thread stays on the fast path
+	long long per_thread = ((num_shoes + num_threads - 1) / num_threads + 3) & ~3LL;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; t++) {
+		long long first = t * per_thread;
+		if (first >= num_shoes)
+			break;
+		long long count = (first + per_thread > num_shoes) ? num_shoes - first : per_thread;
+		threads.push_back(std::thread(ShuffleRange, shoes, num_cards, first, count, seed));
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+}
+
+void MirrorShuffleShoes(uint8_t* shoes, long long num_shoes, int decks_per_shoe, uint64_t seed) {
+	int num_cards = DECK_BYTES * decks_per_shoe;
+	for (long long s = 0; s < num_shoes; s++)
+		ShuffleOne(shoes + s * num_cards, num_cards, seed + s, true);
+}
+
+void PermuteDecks(uint8_t* decks, long long num_decks, const uint8_t* perms, int num_perms) {
+	uint8_t old[DECK_BYTES];
+	for (long long d = 0; d < num_decks; d++) {
+		uint8_t* deck = decks + d * DECK_BYTES;
+		const uint8_t* perm = perms + (d % num_perms) * DECK_BYTES;
+		for (int i = 0; i < DECK_BYTES; i++)
+			old[i] = deck[i];
+		for (int i = 0; i < DECK_BYTES; i++)
+			deck[i] = old[perm[i]];
+	}
+}
+
+void LoadDeck(Deck& deck, const uint8_t* codes, int num_decks) {
+	deck.num_cards = DECK_BYTES * num_decks;
+	for (int i = 0; i < deck.num_cards; i++)
+		deck.cards[i] = CardFromCode(codes[i]);
+	deck.next_card = 0;
+	deck.round_start = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef BULK_SHUFFLE_H
+#define BULK_SHUFFLE_H
+
+/* Shuffling lots of decks at once, for the simulator. A deck here is just 52 bytes of
+* card codes (see GetCardCode) instead of 52 Cards, and the random numbers for four
+* decks are made together in SSE2 registers.
+*
+* Deck d of a batch is exactly what FillDeck, SeedDeck(deck, seed + d) and ShuffleDeck
+* would give, so a bulk-shuffled deck and a normal one can stand in for each other.
+* Shoes of several decks work the same way, with FillShoe.
+*/
+
+#include "Blackjack.h"
+
+#define DECK_BYTES 52
+
+// fills decks with num_decks shuffled decks, DECK_BYTES apiece
+void ShuffleDecks(uint8_t* decks, long long num_decks, uint64_t seed, int num_threads = 1);
+// the same for shoes of decks_per_shoe decks, DECK_BYTES * decks_per_shoe apiece
+void ShuffleShoes(uint8_t* shoes, long long num_shoes, int decks_per_shoe, uint64_t seed, int num_threads = 1);
+
+// the antithetic partners of ShuffleShoes' shoes: every random number the shuffle uses
+// is complemented, which sends each card's swap to the far end of the range instead.
+// No SIMD path; these are only needed for variance reduction runs
+void MirrorShuffleShoes(uint8_t* shoes, long long num_shoes, int decks_per_shoe, uint64_t seed);
+
+// reorders every deck by one of a batch of precomputed permutations (perm d % num_perms
+// for deck d): new deck[i] = old deck[perm[i]]. No random numbers needed at all, so
+// it's the cheap way to get more decks out of a batch that's already been shuffled.
+// A permutation is any shuffled deck, so ShuffleDecks makes them too.
+void PermuteDecks(uint8_t* decks, long long num_decks, const uint8_t* perms, int num_perms);
+
+// ready to deal from, keeps deck.rng
+void LoadDeck(Deck& deck, const uint8_t* codes, int num_decks = 1);
+#endif
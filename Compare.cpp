@@ -0,0 +1,196 @@
+#include "Compare.h"
+
+#include "Simulator.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const char* MODE_NAMES[NUM_COMPARE_MODES] = { "independent", "common cards", "antithetic", "upcard control" };
+
+static void InitializeResult(CompareResult& result) {
+	InitializeStats(result.samples);
+	for (int u = 0; u < MATRIX_UPCARDS; u++) {
+		InitializeStats(result.by_upcard[u]);
+		result.pilot_upcards[u] = 0;
+	}
+	result.pilot_rounds = 0;
+	result.difference = 0;
+	result.confidence = 0;
+	result.cpu_seconds = 0;
+}
+
+static void MergeResult(CompareResult& into, const CompareResult& from) {
+	MergeStats(into.samples, from.samples);
+	for (int u = 0; u < MATRIX_UPCARDS; u++) {
+		MergeStats(into.by_upcard[u], from.by_upcard[u]);
+		into.pilot_upcards[u] += from.pilot_upcards[u];
+	}
+	into.pilot_rounds += from.pilot_rounds;
+	into.cpu_seconds += from.cpu_seconds;
+}
+
+/* PLAYING */
+
+// one round of basic strategy from wherever the deck is; returns the net
+template <class Rules>
+static double PlayFrom(Deck& deck, int& upcard) {
+	Round round;
+	StartRound<Rules>(round, deck, 1.0);
+	upcard = GetCardPoints(round.dealer.cards[0]);
+	FinishRound<Rules>(round, deck);
+	return SettleRound<Rules>(round);
+}
+
+// both rule sets from the same cards; the deal doesn't depend on the rules, so neither
+// does the upcard. The shoe carries on from where a left it
+template <class A, class B>
+static double PlayBoth(Shoe& shoe, int& upcard) {
+	Deck copy = shoe.deck;
+	int same;
+	double net = PlayFrom<A>(shoe.deck, upcard);
+	return net - PlayFrom<B>(copy, same);
+}
+
+// each thread plays on its own shoes and times itself; flat out, that's its CPU time
+template <class A, class B>
+static void CompareThread(CompareResult* result, int mode, long long num_rounds, uint64_t seed) {
+	auto start = chrono::steady_clock::now();
+	Shoe* shoe = new Shoe;
+	Shoe* other = new Shoe;
+	InitializeShoe(*shoe, seed);
+	InitializeShoe(*other, (mode == CompareIndependent) ? seed + SEED_STRIDE / 2 : seed);
+	other->mirrored = mode == CompareAntithetic;
+
+	int upcard;
+	if (mode == CompareAntithetic) {
+		// both shoes of the pair move on together, when either reaches its cut card,
+		// so shoe k always meets its partner
+		for (long long n = 0; n + 1 < num_rounds; n += 2) {
+			if (shoe->deck.next_card >= shoe->cut_card || other->deck.next_card >= other->cut_card) {
+				NextShoe(*shoe);
+				NextShoe(*other);
+			}
+			double first = PlayBoth<A, B>(*shoe, upcard);
+			RecordStat(result->samples, (first + PlayBoth<A, B>(*other, upcard)) / 2);
+		}
+	}
+	else {
+		for (long long n = 0; n < num_rounds; n++) {
+			if (shoe->deck.next_card >= shoe->cut_card)
+				NextShoe(*shoe);
+			if (mode == CompareIndependent) {
+				if (other->deck.next_card >= other->cut_card)
+					NextShoe(*other);
+				double net = PlayFrom<A>(shoe->deck, upcard);
+				RecordStat(result->samples, net - PlayFrom<B>(other->deck, upcard));
+			}
+			else {
+				double difference = PlayBoth<A, B>(*shoe, upcard);
+				RecordStat(result->samples, difference);
+				RecordStat(result->by_upcard[upcard], difference);
+			}
+		}
+	}
+	if (mode == CompareControl) {
+		// the pilot: a's play on shoes of its own, just to count upcards
+		InitializeShoe(*other, seed + SEED_STRIDE / 2);
+		for (long long n = 0; n < num_rounds; n++) {
+			if (other->deck.next_card >= other->cut_card)
+				NextShoe(*other);
+			PlayFrom<A>(other->deck, upcard);
+			result->pilot_upcards[upcard]++;
+		}
+		result->pilot_rounds = num_rounds;
+	}
+	delete other;
+	delete shoe;
+	result->cpu_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* ESTIMATES */
+
+// post-stratification, which is what a control variate on the upcard's indicators
+// comes to with the coefficients fitted from the same run. The weights are the pilot's
+// upcard frequencies, so their own spread goes into the variance too: the pilot is a
+// multinomial sample, independent of the means
+static void ApplyUpcardControl(CompareResult& result) {
+	double variance = 0;
+	double squares = 0;
+	result.difference = 0;
+	for (int u = 2; u < MATRIX_UPCARDS; u++) {
+		const RunningStats& stats = result.by_upcard[u];
+		if (stats.count < 2 || result.pilot_rounds == 0)
+			continue;
+		double chance = (double)result.pilot_upcards[u] / result.pilot_rounds;
+		result.difference += chance * stats.mean;
+		squares += chance * stats.mean * stats.mean;
+		variance += chance * chance * GetVariance(stats) / stats.count;
+	}
+	if (result.pilot_rounds > 0)
+		variance += (squares - result.difference * result.difference) / result.pilot_rounds;
+	result.confidence = 1.96 * sqrt(variance);
+}
+
+void Compare(CompareResult& result, int mode, int rules_a, int rules_b, long long num_rounds, uint64_t seed, int num_threads) {
+	InitializeResult(result);
+	if (num_threads < 1)
+		num_threads = 1;
+	vector<CompareResult*> thread_results(num_threads);
+	vector<thread> threads;
+	CallWithRules(rules_a, [&](auto a) {
+		CallWithRules(rules_b, [&](auto b) {
+			for (int t = 0; t < num_threads; t++) {
+				thread_results[t] = new CompareResult;
+				InitializeResult(*thread_results[t]);
+				CompareResult* mine = thread_results[t];
+				long long rounds = num_rounds / num_threads + (t < num_rounds % num_threads ? 1 : 0);
+				uint64_t thread_seed = seed + t * SEED_STRIDE;
+				threads.push_back(thread([=] { CompareThread<decltype(a), decltype(b)>(mine, mode, rounds, thread_seed); }));
+			}
+		});
+	});
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+		MergeResult(result, *thread_results[t]);
+		delete thread_results[t];
+	}
+	if (mode == CompareControl)
+		ApplyUpcardControl(result);
+	else {
+		result.difference = result.samples.mean;
+		result.confidence = GetConfidence(result.samples);
+	}
+}
+
+void RunComparison(const char* rules_a, const char* rules_b, long long num_rounds, uint64_t seed) {
+	int a = FindRuleSet(rules_a);
+	int b = FindRuleSet(rules_b);
+	if (a < 0 || b < 0 || num_rounds <= 0) {
+		cout << "Need two rule sets (standard, h17, 6to5 or nofrills) and a number of rounds." << endl;
+		return;
+	}
+	int num_threads = (int)thread::hardware_concurrency();
+	cout << rules_a << " minus " << rules_b << ", " << num_rounds << " rounds each" << endl;
+	cout << "mode               return       +/-     CPU s   speedup" << endl;
+	CompareResult* result = new CompareResult;
+	double baseline = 0;	// squared width times CPU time, for CompareIndependent
+	for (int mode = 0; mode < NUM_COMPARE_MODES; mode++) {
+		Compare(*result, mode, a, b, num_rounds, seed, num_threads);
+		double cost = result->confidence * result->confidence * result->cpu_seconds;
+		if (mode == CompareIndependent)
+			baseline = cost;
+		cout << left << setw(15) << MODE_NAMES[mode] << right << fixed << setprecision(3)
+			<< setw(9) << 100.0 * result->difference << "%" << setw(9) << 100.0 * result->confidence << "%"
+			<< setw(10) << setprecision(2) << result->cpu_seconds
+			<< setw(9) << ((cost > 0) ? baseline / cost : 0) << "x" << endl;
+	}
+	cout.unsetf(ios::floatfield);
+	cout << setprecision(6);
+	delete result;
+}
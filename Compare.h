@@ -0,0 +1,48 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+/* Comparing two rule sets. Run separately, each one's house edge has a spread of
+* about 1.15 chips a round, and a difference of a few tenths of a percent takes
+* billions of rounds to stand out from that. Playing both against the same cards
+* cancels most of it out:
+*
+*   CompareIndependent	each set plays its own shoes; the baseline
+*   CompareCommon		common random numbers: both play every round from the same
+*						deck, and the shoe carries on from wherever a left it
+*   CompareAntithetic	as CompareCommon, on a shoe and its MirrorShuffleShoes partner
+*						at once, with each pair of rounds averaged into one sample;
+*						an odd round left over is not played
+*   CompareControl		as CompareCommon, with the dealer's upcard as a control
+*						variate: the differences are averaged per upcard and then
+*						weighted by how often each upcard comes up. With a cut card
+*						that isn't quite 1 in 13 (the deeper rounds go into a shoe
+*						rich in small cards, the more of them there are), so the
+*						weights come from a pilot run on shoes of their own, whose
+*						time and uncertainty count against this mode
+*/
+
+#include "Stats.h"
+
+#include <cstdint>
+
+enum CompareMode { CompareIndependent, CompareCommon, CompareAntithetic, CompareControl };
+#define NUM_COMPARE_MODES 4
+
+struct CompareResult {
+	RunningStats	samples;			// a's return minus b's, per sample
+	RunningStats	by_upcard[MATRIX_UPCARDS];	// the same split by upcard, for CompareControl
+	long long		pilot_upcards[MATRIX_UPCARDS];	// and how often each came up in the pilot
+	long long		pilot_rounds;
+	double			difference;			// the estimate of a's return minus b's, per round
+	double			confidence;			// 95% half-width of difference
+	double			cpu_seconds;		// added up over the threads
+};
+
+// plays num_rounds of each rule set (by CallWithRules number) the way mode says
+void Compare(CompareResult& result, int mode, int rules_a, int rules_b, long long num_rounds, uint64_t seed, int num_threads);
+
+// runs every mode and prints each one's answer and how much CPU time it saves:
+// the speedup is how many times more CPU-seconds CompareIndependent would need to
+// get its confidence interval as narrow
+void RunComparison(const char* rules_a, const char* rules_b, long long num_rounds, uint64_t seed);
+#endif
@@ -0,0 +1,53 @@
+#include "Format.h"
+
+void InitializeText(TextBuffer& text, char* chars, int capacity) {
+	text.chars = chars;
+	text.capacity = capacity;
+	text.length = 0;
+	if (capacity > 0)
+		chars[0] = 0;
+}
+
+void AppendText(TextBuffer& text, std::string_view s) {
+	int room = text.capacity - 1 - text.length;
+	int n = (int)s.size() < room ? (int)s.size() : room;
+	if (n <= 0)
+		return;
+	for (int i = 0; i < n; i++)
+		text.chars[text.length + i] = s[i];
+	text.length += n;
+	text.chars[text.length] = 0;
+}
+
+void AppendChar(TextBuffer& text, char c) {
+	if (text.length + 1 >= text.capacity)
+		return;
+	text.chars[text.length] = c;
+	text.length++;
+	text.chars[text.length] = 0;
+}
+
+void AppendInt(TextBuffer& text, long long n) {
+	char digits[20];		// enough for 2^64
+	int count = 0;
+	// negate as unsigned so the most negative number works too
+	unsigned long long magnitude = (n < 0) ? 0 - (unsigned long long)n : (unsigned long long)n;
+	do {
+		digits[count] = (char)('0' + magnitude % 10);
+		count++;
+		magnitude /= 10;
+	} while (magnitude > 0);
+	if (n < 0)
+		AppendChar(text, '-');
+	while (count > 0) {
+		count--;
+		AppendChar(text, digits[count]);
+	}
+}
+
+std::string_view FormatInt(char* buffer, int size, long long n) {
+	TextBuffer text;
+	InitializeText(text, buffer, size);
+	AppendInt(text, n);
+	return GetText(text);
+}
@@ -0,0 +1,29 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+/* Text into buffers the caller owns: no std::string, no streams, nothing on the heap,
+* so it's fine per hand in a simulation or per frame on screen. A TextBuffer always
+* holds a 0-terminated string, cutting off whatever doesn't fit, and GetText hands it
+* back as a string_view into the caller's buffer.
+*/
+
+#include <string_view>
+
+struct TextBuffer {
+	char*	chars;
+	int		capacity;		// counting the 0 on the end
+	int		length;
+};
+
+void InitializeText(TextBuffer& text, char* chars, int capacity);
+void AppendText(TextBuffer& text, std::string_view s);
+void AppendChar(TextBuffer& text, char c);
+void AppendInt(TextBuffer& text, long long n);
+
+inline std::string_view GetText(const TextBuffer& text) {
+	return std::string_view(text.chars, text.length);
+}
+
+// n's digits in buffer, for when that's all there is to write
+std::string_view FormatInt(char* buffer, int size, long long n);
+#endif
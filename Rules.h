@@ -0,0 +1,336 @@
+#ifndef RULES_H
+#define RULES_H
+
+/* The rules engine. A rule set is a struct of compile-time constants, and every
+* function in here is a template on it, so a table only pays for the options it
+* actually offers: a disabled rule is compiled out rather than tested every hand.
+*
+* Make a variant by inheriting from an existing rule set and hiding what changes.
+*/
+
+#include "Blackjack.h"
+
+#include <string>
+
+#define MAX_HANDS 4	// most hands a player can split into, for any rule set
+
+struct StandardRules {
+	static constexpr int  dealer_stands_on = 17;
+	static constexpr bool dealer_hits_soft_17 = false;	// that is, on a soft dealer_stands_on
+	static constexpr int  max_hands = 4;				// 1 = no splitting, 2 = no resplitting
+	static constexpr bool resplit_aces = false;
+	static constexpr bool hit_split_aces = false;		// split aces get exactly one card each
+	static constexpr bool double_after_split = true;
+	static constexpr bool surrender = true;				// late surrender, after the dealer peeks
+	static constexpr bool insurance = true;
+	static constexpr int  blackjack_pays = 3;			// pays blackjack_pays : blackjack_pays_per
+	static constexpr int  blackjack_pays_per = 2;
+};
+
+struct H17Rules : StandardRules {
+	static constexpr bool dealer_hits_soft_17 = true;
+};
+
+struct SixToFiveRules : H17Rules {
+	static constexpr int  blackjack_pays = 6;
+	static constexpr int  blackjack_pays_per = 5;
+};
+
+struct NoFrillsRules : StandardRules {
+	static constexpr int  max_hands = 2;
+	static constexpr bool double_after_split = false;
+	static constexpr bool surrender = false;
+	static constexpr bool insurance = false;
+};
+
+/* The built-in rule sets by number and name, for picking one at run time. CallWithRules
+* does the one switch and hands f an empty rule set object; f takes it as auto and uses
+* decltype on it, so everything past that point is specialized as usual.
+*/
+
+#define NUM_RULE_SETS 4
+
+inline const char* GetRuleSetName(int id) {
+	static const char* names[NUM_RULE_SETS] = { "standard", "h17", "6to5", "nofrills" };
+	return (id >= 0 && id < NUM_RULE_SETS) ? names[id] : "unknown";
+}
+
+inline int FindRuleSet(const std::string& name) {
+	for (int id = 0; id < NUM_RULE_SETS; id++) {
+		if (name == GetRuleSetName(id))
+			return id;
+	}
+	return -1;
+}
+
+template <class F>
+void CallWithRules(int id, F f) {
+	switch (id) {
+	case 0: f(StandardRules()); break;
+	case 1: f(H17Rules()); break;
+	case 2: f(SixToFiveRules()); break;
+	case 3: f(NoFrillsRules()); break;
+	}
+}
+
+enum Action { Hit, Stand, Double, Split, Surrender };
+
+struct PlayerHand {
+	Hand	cards;
+	double	bet;
+	bool	split_aces;		// this hand came from splitting aces
+	bool	doubled;
+	bool	surrendered;
+	bool	done;
+};
+
+struct Round {
+	PlayerHand	hands[MAX_HANDS];
+	int			num_hands;
+	int			current;		// the hand the player is acting on
+	Hand		dealer;			// cards[0] is the upcard, cards[1] the hole card
+	double		insurance_bet;
+	GameState	state;
+};
+
+inline void InitializePlayerHand(PlayerHand& hand, double bet) {
+	InitializeHand(hand.cards);
+	hand.bet = bet;
+	hand.split_aces = false;
+	hand.doubled = false;
+	hand.surrendered = false;
+	hand.done = false;
+}
+
+// the dealer peeks for blackjack; a natural on either side ends the round right away
+inline void CheckNaturals(Round& round) {
+	if (IsBlackjack(round.dealer) || IsBlackjack(round.hands[0].cards))
+		round.state = GameOver;
+	else round.state = PlayerTurn;
+}
+
+/* WHAT THE PLAYER MAY DO */
+
+template <class Rules>
+bool CanHit(const Round& round) {
+	if (round.state != PlayerTurn)
+		return false;
+	if constexpr (!Rules::hit_split_aces) {
+		if (round.hands[round.current].split_aces)
+			return false;
+	}
+	return true;
+}
+
+template <class Rules>
+bool CanDouble(const Round& round) {
+	const PlayerHand& hand = round.hands[round.current];
+	if (round.state != PlayerTurn || hand.cards.num_cards != 2 || hand.split_aces)
+		return false;
+	if constexpr (!Rules::double_after_split) {
+		if (round.num_hands > 1)
+			return false;
+	}
+	return true;
+}
+
+template <class Rules>
+bool CanSplit(const Round& round) {
+	if constexpr (Rules::max_hands < 2)
+		return false;
+	const PlayerHand& hand = round.hands[round.current];
+	if (round.state != PlayerTurn || hand.cards.num_cards != 2 || round.num_hands >= Rules::max_hands)
+		return false;
+	if constexpr (!Rules::resplit_aces) {
+		if (hand.split_aces)
+			return false;
+	}
+	// any two ten-point cards count as a pair
+	return GetCardPoints(hand.cards.cards[0]) == GetCardPoints(hand.cards.cards[1]);
+}
+
+template <class Rules>
+bool CanSurrender(const Round& round) {
+	if constexpr (!Rules::surrender)
+		return false;
+	return round.state == PlayerTurn && round.num_hands == 1 && round.hands[0].cards.num_cards == 2;
+}
+
+template <class Rules>
+bool CanInsure(const Round& round) {
+	if constexpr (!Rules::insurance)
+		return false;
+	return round.state == InsuranceOffer;
+}
+
+/* PLAYING A ROUND */
+
+// moves on past finished hands; once they're all done it's the dealer's turn, unless
+// every hand busted or surrendered, in which case there's nothing left to play for
+template <class Rules>
+void AdvanceHand(Round& round) {
+	while (round.current < round.num_hands) {
+		PlayerHand& hand = round.hands[round.current];
+		if (GetPoints(hand.cards) >= 21)
+			hand.done = true;
+		if constexpr (!Rules::hit_split_aces) {
+			if (hand.split_aces && !CanSplit<Rules>(round))
+				hand.done = true;
+		}
+		if (!hand.done)
+			return;
+		round.current++;
+	}
+	round.current = round.num_hands - 1;
+	round.state = GameOver;
+	for (int i = 0; i < round.num_hands; i++) {
+		if (!round.hands[i].surrendered && GetPoints(round.hands[i].cards) <= 21)
+			round.state = DealerTurn;
+	}
+}
+
+template <class Rules>
+void StartRound(Round& round, Deck& deck, double bet) {
+	static_assert(Rules::max_hands >= 1 && Rules::max_hands <= MAX_HANDS, "max_hands must be 1 to MAX_HANDS");
+	round.num_hands = 1;
+	round.current = 0;
+	round.insurance_bet = 0;
+	deck.round_start = deck.next_card;
+	InitializePlayerHand(round.hands[0], bet);
+	InitializeHand(round.dealer);
+	AddCardToHand(round.hands[0].cards, DealCard(deck));
+	AddCardToHand(round.dealer, DealCard(deck));
+	AddCardToHand(round.hands[0].cards, DealCard(deck));
+	AddCardToHand(round.dealer, DealCard(deck));
+	if constexpr (Rules::insurance) {
+		if (round.dealer.cards[0].value == Ace) {
+			round.state = InsuranceOffer;
+			return;
+		}
+	}
+	CheckNaturals(round);
+}
+
+// answer the insurance offer; the dealer peeks after this either way
+template <class Rules>
+void TakeInsurance(Round& round, bool take) {
+	if (!CanInsure<Rules>(round))
+		return;
+	if (take)
+		round.insurance_bet = round.hands[0].bet / 2;
+	CheckNaturals(round);
+}
+
+// returns false (and changes nothing) if the action isn't allowed right now
+template <class Rules>
+bool ApplyAction(Round& round, Deck& deck, Action action) {
+	if (round.state != PlayerTurn)
+		return false;
+	PlayerHand& hand = round.hands[round.current];
+	switch (action) {
+	case Hit:
+		if (!CanHit<Rules>(round))
+			return false;
+		AddCardToHand(hand.cards, DealCard(deck));
+		break;
+	case Stand:
+		hand.done = true;
+		break;
+	case Double:
+		if (!CanDouble<Rules>(round))
+			return false;
+		hand.bet *= 2;
+		hand.doubled = true;
+		AddCardToHand(hand.cards, DealCard(deck));
+		hand.done = true;
+		break;
+	case Split: {
+		if (!CanSplit<Rules>(round))
+			return false;
+		// the new hand goes right after this one, so hands are played left to right
+		for (int i = round.num_hands; i > round.current + 1; i--)
+			round.hands[i] = round.hands[i - 1];
+		round.num_hands++;
+		PlayerHand& other = round.hands[round.current + 1];
+		InitializePlayerHand(other, hand.bet);
+		AddCardToHand(other.cards, hand.cards.cards[1]);
+		hand.cards.num_cards = 1;
+		hand.split_aces = other.split_aces = (hand.cards.cards[0].value == Ace);
+		AddCardToHand(hand.cards, DealCard(deck));
+		AddCardToHand(other.cards, DealCard(deck));
+		break;
+	}
+	case Surrender:
+		if (!CanSurrender<Rules>(round))
+			return false;
+		hand.surrendered = true;
+		hand.done = true;
+		break;
+	}
+	AdvanceHand<Rules>(round);
+	return true;
+}
+
+template <class Rules>
+bool DealerShouldHit(const Hand& dealer) {
+	int points = GetPoints(dealer);
+	if (points < Rules::dealer_stands_on)
+		return true;
+	if constexpr (Rules::dealer_hits_soft_17)
+		return points == Rules::dealer_stands_on && IsSoft(dealer);
+	return false;
+}
+
+// draws all of the dealer's cards at once; the game paces them with DealerShouldHit instead
+template <class Rules>
+void PlayDealer(Round& round, Deck& deck) {
+	while (DealerShouldHit<Rules>(round.dealer))
+		AddCardToHand(round.dealer, DealCard(deck));
+	round.state = GameOver;
+}
+
+/* PAYING OUT */
+
+// what hand i won (positive) or lost (negative), in chips
+template <class Rules>
+double HandResult(const Round& round, int i) {
+	const PlayerHand& hand = round.hands[i];
+	if (hand.surrendered)
+		return -hand.bet / 2;
+	int points = GetPoints(hand.cards);
+	if (points > 21)
+		return -hand.bet;
+	// a split hand that makes 21 in two cards is just 21
+	bool natural = round.num_hands == 1 && IsBlackjack(hand.cards);
+	bool dealer_natural = IsBlackjack(round.dealer);
+	if (natural && dealer_natural)
+		return 0;
+	if (natural)
+		return hand.bet * Rules::blackjack_pays / Rules::blackjack_pays_per;
+	if (dealer_natural)
+		return -hand.bet;
+	int dealer_points = GetPoints(round.dealer);
+	if (dealer_points > 21 || points > dealer_points)
+		return hand.bet;
+	if (points < dealer_points)
+		return -hand.bet;
+	return 0;
+}
+
+template <class Rules>
+double InsuranceResult(const Round& round) {
+	if constexpr (!Rules::insurance)
+		return 0;
+	if (round.insurance_bet == 0)
+		return 0;
+	return IsBlackjack(round.dealer) ? 2 * round.insurance_bet : -round.insurance_bet;
+}
+
+template <class Rules>
+double SettleRound(const Round& round) {
+	double net = InsuranceResult<Rules>(round);
+	for (int i = 0; i < round.num_hands; i++)
+		net += HandResult<Rules>(round, i);
+	return net;
+}
+#endif
@@ -1,5 +1,7 @@
 #include "SDL_Wrapper.h"
 
+#include "Format.h"
+
 /* 11-12-15 D. Wilckens Cleaned-up SDL Wrapper */
 
 #include "SDL.h"
@@ -8,10 +10,18 @@
 #include "SDL_mixer.h"
 
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #define MAX_TEXTURES 64
+#define MAX_CANVASES 16
+#define MAX_DRAW_COMMANDS 8192	// per frame; any more are dropped
+#define LAYER_LOOKBACK 64		// earlier commands each one is checked against when sorting
 #define MAX_MUSIC_CHUNKS 64
 #define NUM_SOUND_CHANNELS 8
 #define MAX_MIX_CHUNKS 64
@@ -19,6 +29,13 @@
 #define COLORKEY_R 255
 #define COLORKEY_G 0
 #define COLORKEY_B 255
+#define COLORKEY_PIXEL 0xFFFF00FFu
+
+// x86 builds get SSE2 by default, everything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WRAPPER_SSE2
+#include <emmintrin.h>
+#endif
 
 static std::ofstream err_log;
 
@@ -28,6 +45,31 @@ struct FontBank {
 	int				height;
 };
 
+/* The drawing calls don't touch SDL: they record DrawCommands, and Refresh() hands the
+* frame's list to the render thread, which owns the renderer. It reorders the list so
+* that draws sharing a texture or color run together, without moving anything past a
+* draw it overlaps, then replays it and presents. The game records the next frame
+* meanwhile, so it's never stuck waiting on the driver or vsync for more than a frame.
+*/
+
+enum DrawOp { OpClear, OpFillRect, OpPoint, OpLine, OpCopy };
+
+struct DrawCommand {
+	SDL_Texture*	texture;		// OpCopy only
+	PixelCanvas*	canvas;			// OpCopy of a canvas, which is uploaded first if it's changed
+	SDL_Rect		src;			// for OpLine, the end points: x, y to w, h
+	SDL_Rect		dest;			// what it covers, which for OpLine is the bounding box
+	Uint8			op, r, g, b;
+	int				layer;			// filled in by the render thread
+	int				order;			// and where it was recorded, so sorting needn't be stable
+};
+
+struct DrawList {
+	DrawCommand		commands[MAX_DRAW_COMMANDS];
+	int				count;
+	bool			overflowed;
+};
+
 struct SystemData {
 	int				window_width,
 	window_height;
@@ -40,15 +82,42 @@ struct SystemData {
 	bool            mouse_button_previous_states[3];
 	int				texture_count;
 	SDL_Texture*	loaded_textures[MAX_TEXTURES];
+	int				canvas_count;
+	PixelCanvas*	canvases[MAX_CANVASES];
 	FontBank		default_font;
 	Mix_Music*		music_chunks[MAX_MUSIC_CHUNKS];
 	int				music_chunk_count;
 	int				next_sound_channel;  // every time we play another sound effect, bump this up, modulo NUM_SOUND_CHANNELS
 	Mix_Chunk*		mix_chunks[MAX_MIX_CHUNKS];
 	int				mix_chunk_count;
+	Uint64			start_counter;		// performance counter value at InitSystem
+	double			counter_ms;			// milliseconds per performance counter tick
+
+	// drawing: the game records into draw_lists[recording], the render thread replays the other
+	DrawList*		draw_lists[2];
+	int				recording;
+	SDL_Color		draw_color;			// the last color recorded, which ClearScreen uses
+	std::thread		render_thread;
+	std::mutex		render_mutex;
+	std::condition_variable	render_wake;	// something for the render thread to do
+	std::condition_variable	render_done;	// it's done it
+	bool			frame_pending;		// the other list is submitted and not presented yet
+	std::function<void()>	render_task;	// a one-off job, e.g. making a texture
+	bool			render_quit;
 
 	bool				internal_error;
-	std::stringstream   internal_error_message;
+	char				internal_error_message[256];
+
+	// brought up on first use (see STARTUP)
+	std::thread		font_thread;
+	SDL_Surface*	font_surface;		// what the font thread made, until it's a texture
+	Uint64			font_counts;		// how long that took
+	bool			font_failed;
+	bool			font_ready;			// default_font has its texture
+	bool			audio_open;
+	int				image_codecs;		// the IMG_INIT_ flags tried so far
+	int				music_codecs;		// and the MIX_INIT_ ones
+	bool			first_frame_traced;
 };
 
 static SystemData sys;
@@ -67,81 +136,237 @@ Magenta = { 255, 0, 255 }, ColorKey = { 255, 0, 255 };
 
 // forward declarations
 static void CreateFontBank(FontBank* fb, const char* fontName, int pointSize, SDL_Color color);
+static FontBank* GetDefaultFont();
 static void FreeAllTextures();
 static void FreeAllMusicAndSoundChunks();
+static void RenderLoop();
+static void CallOnRenderThread(std::function<void()> task);
+static void WaitForRenderThread();
+
+static std::mutex log_mutex;		// the font thread logs too
 
 void WriteLog(const char* s) {
+	std::lock_guard<std::mutex> lock(log_mutex);
 	err_log << s << std::endl;
 	err_log.flush();
 }
 
+/* STARTUP */
+
+/* InitSystem only brings up what the first frame needs: video, the window and the render
+* thread. The font is rasterized on a thread of its own meanwhile and made into a texture
+* the first time text is drawn. Audio opens on the first LoadSound or LoadMusic, and each
+* image or music format's library loads with the first file that needs it, so nothing is
+* spent on formats the game never uses.
+*
+* SDL's subsystems can't be started from two threads at once, so video and audio take
+* turns; the font needs only SDL_ttf and surfaces, so it overlaps with both. Each phase
+* is timed into the log as "Startup: <phase> <ms>".
+*/
+
+struct Codec {
+	const char*	extension;
+	int			flag;
+};
+
+static const Codec image_codecs[] = {
+	{ ".png", IMG_INIT_PNG }, { ".jpg", IMG_INIT_JPG }, { ".jpeg", IMG_INIT_JPG },
+	{ ".tif", IMG_INIT_TIF }, { ".tiff", IMG_INIT_TIF }
+};
+
+// Mix_LoadWAV reads .ogg too; plain .wav needs no library at all
+static const Codec music_codecs[] = {
+	{ ".ogg", MIX_INIT_OGG }, { ".mp3", MIX_INIT_MP3 }, { ".flac", MIX_INIT_FLAC },
+	{ ".mod", MIX_INIT_MOD }, { ".xm", MIX_INIT_MOD }, { ".s3m", MIX_INIT_MOD }, { ".it", MIX_INIT_MOD }
+};
+
+static void TraceStartup(const char* phase, const char* detail, Uint64 counts) {
+	long long tenths = (long long)(counts * sys.counter_ms * 10.0 + 0.5);
+	char line[128];
+	TextBuffer text;
+	InitializeText(text, line, sizeof(line));
+	AppendText(text, "Startup: ");
+	AppendText(text, phase);
+	AppendChar(text, ' ');
+	AppendText(text, detail);
+	if (detail[0] != 0)
+		AppendChar(text, ' ');
+	AppendInt(text, tenths / 10);
+	AppendChar(text, '.');
+	AppendInt(text, tenths % 10);
+	AppendText(text, " ms");
+	WriteLog(line);
+}
+
+// the flag for filename's extension, or 0 if it needs none
+static int FindCodec(const char* filename, const Codec* codecs, int count) {
+	const char* extension = strrchr(filename, '.');
+	if (extension == NULL)
+		return 0;
+	for (int i = 0; i < count; i++) {
+		if (SDL_strcasecmp(extension, codecs[i].extension) == 0)
+			return codecs[i].flag;
+	}
+	return 0;
+}
+
+static void LoadImageCodec(const char* filename) {
+	int flag = FindCodec(filename, image_codecs, sizeof(image_codecs) / sizeof(image_codecs[0]));
+	if (flag == 0 || (sys.image_codecs & flag) != 0)
+		return;
+	// only tried once; if it fails, IMG_Load says why for each file
+	sys.image_codecs |= flag;
+	Uint64 start = SDL_GetPerformanceCounter();
+	if ((IMG_Init(flag) & flag) == 0) {
+		WriteLog("Failed to initialize image format:");
+		WriteLog(IMG_GetError());
+	}
+	TraceStartup("image format", strrchr(filename, '.'), SDL_GetPerformanceCounter() - start);
+}
+
+static void OpenAudio() {
+	if (sys.audio_open)
+		return;
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+		WriteLog("Couldn't initialize SDL audio.");
+		WriteLog(SDL_GetError());
+		exit(0);
+	}
+	if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 1024) != 0) {
+		WriteLog("Failed to open audio.");
+		WriteLog(Mix_GetError());
+		exit(0);
+	}
+	Mix_AllocateChannels(NUM_SOUND_CHANNELS);
+	sys.audio_open = true;
+	TraceStartup("audio", "", SDL_GetPerformanceCounter() - start);
+}
+
+static void LoadMusicCodec(const char* filename) {
+	int flag = FindCodec(filename, music_codecs, sizeof(music_codecs) / sizeof(music_codecs[0]));
+	if (flag == 0 || (sys.music_codecs & flag) != 0)
+		return;
+	sys.music_codecs |= flag;
+	Uint64 start = SDL_GetPerformanceCounter();
+	if ((Mix_Init(flag) & flag) == 0) {
+		WriteLog("Failed to initialize sound format:");
+		WriteLog(Mix_GetError());
+	}
+	TraceStartup("sound format", strrchr(filename, '.'), SDL_GetPerformanceCounter() - start);
+}
+
+// on the font thread
+static void RasterizeDefaultFont() {
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (TTF_Init() != 0) {
+		WriteLog("Failed to initialize TrueTypeFonts.");
+		WriteLog(TTF_GetError());
+		sys.font_failed = true;
+		return;
+	}
+	SDL_Color White = { 255, 255, 255, 255 };
+	CreateFontBank(&sys.default_font, "OpenSans-Regular.ttf", 32, White);
+	sys.font_counts = SDL_GetPerformanceCounter() - start;
+}
+
 void InitSystem(int window_width, int window_height) {
 	err_log.open("Logfile.txt", std::ofstream::out);
+	sys.start_counter = SDL_GetPerformanceCounter();
+	sys.counter_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
 	sys.window_width = window_width;
 	sys.window_height = window_height;
-	int sdl_init_success =
-		SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
+	sys.font_surface = NULL;
+	sys.font_failed = false;
+	sys.font_ready = false;
+	sys.audio_open = false;
+	sys.image_codecs = 0;
+	sys.music_codecs = 0;
+	sys.first_frame_traced = false;
+	sys.font_thread = std::thread(RasterizeDefaultFont);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	int sdl_init_success = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
 	if (sdl_init_success != 0) {
 		WriteLog("Couldn't initialize SDL.");
 		WriteLog(SDL_GetError());
 		exit(0);
 	}
-
-	int create_window_success = SDL_CreateWindowAndRenderer(window_width, window_height, SDL_WINDOW_BORDERLESS, &(sys.window), &(sys.renderer));
-	if (create_window_success != 0) {
-		WriteLog("Couldn't create window & renderer.");
+	TraceStartup("video", "", SDL_GetPerformanceCounter() - start);
+
+	// let presenting wait for the display instead of the game sleeping a fixed amount
+	SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
+	start = SDL_GetPerformanceCounter();
+	sys.window = SDL_CreateWindow("", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width, window_height, SDL_WINDOW_BORDERLESS);
+	if (sys.window == NULL) {
+		WriteLog("Couldn't create window.");
+		WriteLog(SDL_GetError());
+		exit(0);
+	}
+	TraceStartup("window", "", SDL_GetPerformanceCounter() - start);
+	start = SDL_GetPerformanceCounter();
+	// the renderer belongs to the render thread from the start, so it's made there
+	sys.draw_lists[0] = new DrawList;
+	sys.draw_lists[1] = new DrawList;
+	sys.draw_lists[0]->count = 0;
+	sys.draw_lists[0]->overflowed = false;
+	sys.recording = 0;
+	sys.draw_color = { 0, 0, 0, 255 };
+	sys.frame_pending = false;
+	sys.render_quit = false;
+	sys.render_thread = std::thread(RenderLoop);
+	CallOnRenderThread([] { sys.renderer = SDL_CreateRenderer(sys.window, -1, 0); });
+	if (sys.renderer == NULL) {
+		WriteLog("Couldn't create renderer.");
 		WriteLog(SDL_GetError());
 		exit(0);
 	}
+	TraceStartup("renderer", "", SDL_GetPerformanceCounter() - start);
 	SDL_SetWindowPosition(sys.window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
 	if (sys.window != NULL)
 		sys.running = true;
 	else sys.running = false;
 	for (int i = 0; i < 256; i++)
 		sys.down_keys[i] = false;
-	int IMG_flags = IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF;
-	if (IMG_Init(IMG_flags) != IMG_flags) {
-		WriteLog("Failed to initialize all desired image formats.");
-		WriteLog(IMG_GetError());
-	}
-	if (TTF_Init() != 0) {
-		WriteLog("Failed to initialize TrueTypeFonts.");
-		WriteLog(TTF_GetError());
-		exit(0);
-	}
-
-	SDL_Color White = { 255, 255, 255, 255 };
-	CreateFontBank(&sys.default_font, "OpenSans-Regular.ttf", 32, White);
 
 	sys.texture_count = 0;
-	int Mix_flags = MIX_INIT_FLAC | MIX_INIT_MOD | MIX_INIT_MP3 | MIX_INIT_OGG;
-	if (Mix_Init(Mix_flags) != Mix_flags) {
-		WriteLog("Failed to initialize all desired sound formats.");
-		WriteLog(Mix_GetError());
-	}
-	if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 1024) != 0) {
-		WriteLog("Failed to open audio.");
-		WriteLog(Mix_GetError());
-		exit(0);
-	}
+	sys.canvas_count = 0;
 	sys.music_chunk_count = 0;
-
-	Mix_AllocateChannels(NUM_SOUND_CHANNELS);
 	sys.next_sound_channel = 0;
 	sys.mix_chunk_count = 0;
 
 	sys.internal_error = false;
+	TraceStartup("InitSystem", "", SDL_GetPerformanceCounter() - sys.start_counter);
 }
 
 void CloseSystem() {
 	FreeAllMusicAndSoundChunks();
-	Mix_CloseAudio();
+	if (sys.audio_open)
+		Mix_CloseAudio();
 	Mix_Quit();
+	if (sys.font_thread.joinable())
+		sys.font_thread.join();
+	if (sys.font_surface != NULL)
+		SDL_FreeSurface(sys.font_surface);
+	sys.font_surface = NULL;
 	TTF_Quit();
-	FreeAllTextures();
-	SDL_DestroyTexture(sys.default_font.texture);
+	WaitForRenderThread();
+	CallOnRenderThread([] {
+		FreeAllTextures();
+		if (sys.font_ready)
+			SDL_DestroyTexture(sys.default_font.texture);
+		SDL_DestroyRenderer(sys.renderer);
+	});
+	sys.font_ready = false;
+	{
+		std::lock_guard<std::mutex> lock(sys.render_mutex);
+		sys.render_quit = true;
+	}
+	sys.render_wake.notify_one();
+	sys.render_thread.join();
+	delete sys.draw_lists[0];
+	delete sys.draw_lists[1];
 	IMG_Quit();
-	SDL_DestroyRenderer(sys.renderer);
 	SDL_DestroyWindow(sys.window);
 	SDL_Quit();
 	sys.running = false;
@@ -154,14 +379,15 @@ bool QueryError() {
 
 const char* GetErrorMsg() {
 	sys.internal_error = false;
-	return sys.internal_error_message.str().c_str();
+	return sys.internal_error_message;
 }
 
 // this ERASES any existing error messages...sorry!
 static void SetError(const char* msg) {
 	sys.internal_error = true;
-	sys.internal_error_message.flush();
-	sys.internal_error_message << msg;
+	TextBuffer text;
+	InitializeText(text, sys.internal_error_message, sizeof(sys.internal_error_message));
+	AppendText(text, msg);
 }
 
 
@@ -171,6 +397,8 @@ Music LoadMusic(const char* filename) {
 		return{ 0 };
 	}
 
+	OpenAudio();
+	LoadMusicCodec(filename);
 	Mix_Music* chunk = Mix_LoadMUS(filename);
 	if (chunk == NULL) {
 		WriteLog("Error: Couldn't load this music filename:");
@@ -218,6 +446,8 @@ Sound LoadSound(const char* filename) {
 		WriteLog("Error:LoadSound:Reached maximum number of mix chunks.");
 		return{ 0 };
 	}
+	OpenAudio();
+	LoadMusicCodec(filename);
 	Sound out;
 	out.mix_chunk = Mix_LoadWAV(filename);
 	if (out.mix_chunk == NULL) {
@@ -263,8 +493,182 @@ int GetWindowWidth() {
 	return sys.window_width;
 }
 
+/* RENDER THREAD */
+
+// runs task on the render thread and waits for it; anything that touches the renderer
+// or makes a texture goes through here
+static void CallOnRenderThread(std::function<void()> task) {
+	std::unique_lock<std::mutex> lock(sys.render_mutex);
+	sys.render_task = task;
+	sys.render_wake.notify_one();
+	sys.render_done.wait(lock, [] { return !sys.render_task; });
+}
+
+// until the submitted frame, if there is one, is on screen
+static void WaitForRenderThread() {
+	std::unique_lock<std::mutex> lock(sys.render_mutex);
+	sys.render_done.wait(lock, [] { return !sys.frame_pending; });
+}
+
+static bool SameState(const DrawCommand& a, const DrawCommand& b) {
+	if (a.op == OpCopy || b.op == OpCopy)
+		return a.op == b.op && a.texture == b.texture;
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static bool Overlaps(const SDL_Rect& a, const SDL_Rect& b) {
+	return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static bool Covers(const SDL_Rect& outer, const SDL_Rect& inner) {
+	return outer.x <= inner.x && outer.y <= inner.y
+		&& outer.x + outer.w >= inner.x + inner.w && outer.y + outer.h >= inner.y + inner.h;
+}
+
+// a command goes in a layer above everything earlier it overlaps that needs different
+// state, and no lower than anything earlier it overlaps that doesn't; then within a
+// layer nothing overlaps out of order, and it can be grouped by state freely.
+// Only the last LAYER_LOOKBACK commands are checked, so it stays linear however many
+// there are; anything further back is assumed to overlap with different state, which
+// keeps submission order between the two and costs some grouping in very long lists
+static void AssignLayers(DrawList& list) {
+	int settled = -1;		// the top layer among commands past the lookback
+	for (int i = 0; i < list.count; i++) {
+		DrawCommand& command = list.commands[i];
+		command.order = i;
+		if (i > LAYER_LOOKBACK)
+			settled = std::max(settled, list.commands[i - LAYER_LOOKBACK - 1].layer);
+		command.layer = 0;
+		bool covered = false;
+		for (int j = i - 1; j >= 0 && j >= i - LAYER_LOOKBACK; j--) {
+			const DrawCommand& earlier = list.commands[j];
+			if (!Overlaps(earlier.dest, command.dest))
+				continue;
+			int layer = earlier.layer + (SameState(earlier, command) ? 0 : 1);
+			if (layer > command.layer)
+				command.layer = layer;
+			// anything further back under this is already accounted for by it
+			if (Covers(earlier.dest, command.dest)) {
+				covered = true;
+				break;
+			}
+		}
+		if (!covered && settled + 1 > command.layer)
+			command.layer = settled + 1;
+	}
+}
+
+static bool DrawsBefore(const DrawCommand& a, const DrawCommand& b) {
+	if (a.layer != b.layer)
+		return a.layer < b.layer;
+	if ((a.op == OpCopy) != (b.op == OpCopy))
+		return a.op != OpCopy;
+	if (a.op == OpCopy) {
+		if (a.texture != b.texture)
+			return a.texture < b.texture;
+	}
+	else {
+		int a_color = (a.r << 16) | (a.g << 8) | a.b;
+		int b_color = (b.r << 16) | (b.g << 8) | b.b;
+		if (a_color != b_color)
+			return a_color < b_color;
+	}
+	return a.order < b.order;
+}
+
+// copies what the list's frame shows of each changed canvas into its texture, once
+static void UploadCanvases(DrawList& list, int list_index) {
+	for (int i = 0; i < list.count; i++) {
+		PixelCanvas* canvas = list.commands[i].canvas;
+		if (canvas == NULL || canvas->uploaded_version == canvas->staged_version[list_index])
+			continue;
+		void* pixels;
+		int pitch;
+		if (SDL_LockTexture(canvas->texture, NULL, &pixels, &pitch) != 0)
+			continue;
+		for (int y = 0; y < canvas->h; y++)
+			memcpy((Uint8*)pixels + y * pitch, canvas->staged[list_index] + y * canvas->w, canvas->w * sizeof(Uint32));
+		SDL_UnlockTexture(canvas->texture);
+		canvas->uploaded_version = canvas->staged_version[list_index];
+	}
+}
+
+static void ReplayDrawList(DrawList& list, int list_index) {
+	UploadCanvases(list, list_index);
+	AssignLayers(list);
+	// std::sort works in place; stable_sort could allocate a buffer every frame
+	std::sort(list.commands, list.commands + list.count, DrawsBefore);
+	bool have_color = false;
+	Uint8 r = 0, g = 0, b = 0;
+	for (int i = 0; i < list.count; i++) {
+		const DrawCommand& command = list.commands[i];
+		if (command.op != OpCopy && (!have_color || command.r != r || command.g != g || command.b != b)) {
+			r = command.r;
+			g = command.g;
+			b = command.b;
+			SDL_SetRenderDrawColor(sys.renderer, r, g, b, 0);
+			have_color = true;
+		}
+		switch (command.op) {
+		case OpClear: SDL_RenderClear(sys.renderer); break;
+		case OpFillRect: SDL_RenderFillRect(sys.renderer, &command.dest); break;
+		case OpPoint: SDL_RenderDrawPoint(sys.renderer, command.dest.x, command.dest.y); break;
+		case OpLine: SDL_RenderDrawLine(sys.renderer, command.src.x, command.src.y, command.src.w, command.src.h); break;
+		case OpCopy: SDL_RenderCopy(sys.renderer, command.texture, &command.src, &command.dest); break;
+		}
+	}
+}
+
+static void RenderLoop() {
+	std::unique_lock<std::mutex> lock(sys.render_mutex);
+	for (;;) {
+		sys.render_wake.wait(lock, [] { return sys.render_task || sys.frame_pending || sys.render_quit; });
+		if (sys.render_task) {
+			sys.render_task();
+			sys.render_task = nullptr;
+			sys.render_done.notify_all();
+		}
+		else if (sys.frame_pending) {
+			// the game only touches the other list until this one's presented
+			int list_index = 1 - sys.recording;
+			DrawList* list = sys.draw_lists[list_index];
+			lock.unlock();
+			ReplayDrawList(*list, list_index);
+			SDL_RenderPresent(sys.renderer);
+			lock.lock();
+			sys.frame_pending = false;
+			sys.render_done.notify_all();
+		}
+		else return;
+	}
+}
+
+// the next free command in the list being recorded, or NULL once it's full
+static DrawCommand* RecordCommand(DrawOp op, Uint8 r, Uint8 g, Uint8 b) {
+	DrawList* list = sys.draw_lists[sys.recording];
+	if (list->count >= MAX_DRAW_COMMANDS) {
+		if (!list->overflowed)
+			WriteLog("Too many draw commands in one frame; dropping the rest.");
+		list->overflowed = true;
+		return NULL;
+	}
+	DrawCommand* command = &list->commands[list->count];
+	list->count++;
+	command->op = (Uint8)op;
+	command->r = r;
+	command->g = g;
+	command->b = b;
+	command->texture = NULL;
+	command->canvas = NULL;
+	if (op != OpCopy)
+		sys.draw_color = { r, g, b, 255 };
+	return command;
+}
+
 void ClearScreen() {
-	SDL_RenderClear(sys.renderer);
+	DrawCommand* command = RecordCommand(OpClear, sys.draw_color.r, sys.draw_color.g, sys.draw_color.b);
+	if (command != NULL)
+		command->dest = { 0, 0, sys.window_width, sys.window_height };
 }
 
 static void PushTexture(SDL_Texture* text) {
@@ -284,21 +688,31 @@ static void FreeAllTextures() {
 	for (int i = 0; i < sys.texture_count; i++)
 		SDL_DestroyTexture(sys.loaded_textures[i]);
 	sys.texture_count = 0;
+	for (int i = 0; i < sys.canvas_count; i++) {
+		PixelCanvas* canvas = sys.canvases[i];
+		delete[] canvas->pixels;
+		delete[] canvas->staged[0];
+		delete[] canvas->staged[1];
+		delete canvas;
+	}
+	sys.canvas_count = 0;
 }
 
 Image LoadImage(const char* filename) {
 	Image out;
 	out.texture = NULL;
+	LoadImageCodec(filename);
 	SDL_Surface* surface;
 	surface = IMG_Load(filename);
 	if (!surface) {
-		err_log << "IMG_Load Failed:" << IMG_GetError() << std::endl;
+		WriteLog("IMG_Load Failed:");
+		WriteLog(IMG_GetError());
 		return{ 0 };
 	}
 	// colorkey is magenta:
 	Uint32 colorkey = SDL_MapRGB(surface->format, COLORKEY_R, COLORKEY_G, COLORKEY_B);
 	SDL_SetColorKey(surface, SDL_TRUE, colorkey);
-	out.texture = SDL_CreateTextureFromSurface(sys.renderer, surface);
+	CallOnRenderThread([&] { out.texture = SDL_CreateTextureFromSurface(sys.renderer, surface); });
 	out.x = 0;
 	out.y = 0;
 	out.w = surface->w;
@@ -336,32 +750,196 @@ void DrawImage(Image& im, int x, int y) {
 	dest.y = y;
 	dest.w = src.w;
 	dest.h = src.h;
-	SDL_RenderCopy(sys.renderer, im.texture, &src, &dest);
-}
-
-static void SetColor(const Color& c) {
-	SDL_SetRenderDrawColor(sys.renderer, c.r, c.g, c.b, 0);
+	DrawCommand* command = RecordCommand(OpCopy, 0, 0, 0);
+	if (command == NULL)
+		return;
+	command->texture = im.texture;
+	command->src = src;
+	command->dest = dest;
 }
 
 void FillRect(int x, int y, int w, int h, const Color& c) {
-	SetColor(c);
-	SDL_Rect rect = { x, y, w, h };
-	SDL_RenderFillRect(sys.renderer, &rect);
+	DrawCommand* command = RecordCommand(OpFillRect, c.r, c.g, c.b);
+	if (command != NULL)
+		command->dest = { x, y, w, h };
 }
 
 void DrawPixel(int x, int y, const Color& c) {
-	SetColor(c);
-	SDL_RenderDrawPoint(sys.renderer, x, y);
+	DrawPixel(x, y, c.r, c.g, c.b);
 }
 
 void DrawPixel(int x, int y, int r, int g, int b) {
-	SDL_SetRenderDrawColor(sys.renderer, r, g, b, 0);
-	SDL_RenderDrawPoint(sys.renderer, x, y);
+	DrawCommand* command = RecordCommand(OpPoint, r, g, b);
+	if (command != NULL)
+		command->dest = { x, y, 1, 1 };
 }
 
 void DrawLine(int x1, int y1, int x2, int y2, const Color& c) {
-	SetColor(c);
-	SDL_RenderDrawLine(sys.renderer, x1, y1, x2, y2);
+	DrawCommand* command = RecordCommand(OpLine, c.r, c.g, c.b);
+	if (command == NULL)
+		return;
+	command->src = { x1, y1, x2, y2 };
+	command->dest = { std::min(x1, x2), std::min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1 };
+}
+
+/* PIXEL CANVAS */
+
+PixelCanvas* CreateCanvas(int w, int h) {
+	if (w <= 0 || h <= 0) {
+		WriteLog("Error:CreateCanvas:Width and height must be at least 1.");
+		return NULL;
+	}
+	if (sys.canvas_count >= MAX_CANVASES) {
+		WriteLog("Error:CreateCanvas:Reached maximum number of canvases.");
+		return NULL;
+	}
+	PixelCanvas* canvas = new PixelCanvas;
+	canvas->w = w;
+	canvas->h = h;
+	canvas->pixels = new Uint32[w * h];
+	canvas->staged[0] = new Uint32[w * h];
+	canvas->staged[1] = new Uint32[w * h];
+	memset(canvas->pixels, 0, w * h * sizeof(Uint32));
+	canvas->version = 1;
+	canvas->staged_version[0] = 0;
+	canvas->staged_version[1] = 0;
+	canvas->uploaded_version = 0;
+	CallOnRenderThread([&] {
+		canvas->texture = SDL_CreateTexture(sys.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+		// so pixels nothing has been drawn on (alpha 0) let what's behind show through
+		SDL_SetTextureBlendMode(canvas->texture, SDL_BLENDMODE_BLEND);
+	});
+	PushTexture(canvas->texture);
+	sys.canvases[sys.canvas_count] = canvas;
+	sys.canvas_count++;
+	return canvas;
+}
+
+Uint32 CanvasColor(const Color& c) {
+	return 0xFF000000u | ((Uint32)c.r << 16) | ((Uint32)c.g << 8) | (Uint32)c.b;
+}
+
+Uint32* LockCanvas(PixelCanvas* canvas) {
+	canvas->version++;
+	return canvas->pixels;
+}
+
+static void FillSpan(Uint32* row, int n, Uint32 value) {
+#ifdef WRAPPER_SSE2
+	__m128i values = _mm_set1_epi32((int)value);
+	for (; n >= 4; n -= 4, row += 4)
+		_mm_storeu_si128((__m128i*)row, values);
+#endif
+	for (; n > 0; n--, row++)
+		*row = value;
+}
+
+// like FillSpan, except the color key in src leaves dest alone
+static void BlitSpan(Uint32* dest, const Uint32* src, int n) {
+#ifdef WRAPPER_SSE2
+	__m128i key = _mm_set1_epi32((int)COLORKEY_PIXEL);
+	for (; n >= 4; n -= 4, dest += 4, src += 4) {
+		__m128i from = _mm_loadu_si128((const __m128i*)src);
+		__m128i to = _mm_loadu_si128((const __m128i*)dest);
+		__m128i keyed = _mm_cmpeq_epi32(from, key);
+		_mm_storeu_si128((__m128i*)dest, _mm_or_si128(_mm_and_si128(keyed, to), _mm_andnot_si128(keyed, from)));
+	}
+#endif
+	for (; n > 0; n--, dest++, src++) {
+		if (*src != COLORKEY_PIXEL)
+			*dest = *src;
+	}
+}
+
+// trims x, y, w, h to the canvas; false if nothing's left
+static bool ClipToCanvas(const PixelCanvas* canvas, int& x, int& y, int& w, int& h) {
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (x + w > canvas->w)
+		w = canvas->w - x;
+	if (y + h > canvas->h)
+		h = canvas->h - y;
+	return w > 0 && h > 0;
+}
+
+void FillCanvasRect(PixelCanvas* canvas, int x, int y, int w, int h, const Color& c) {
+	if (!ClipToCanvas(canvas, x, y, w, h))
+		return;
+	Uint32 value = CanvasColor(c);
+	Uint32* pixels = LockCanvas(canvas);
+	for (int row = y; row < y + h; row++)
+		FillSpan(pixels + row * canvas->w + x, w, value);
+}
+
+void DrawCanvasPixel(PixelCanvas* canvas, int x, int y, const Color& c) {
+	if (x < 0 || y < 0 || x >= canvas->w || y >= canvas->h)
+		return;
+	LockCanvas(canvas)[y * canvas->w + x] = CanvasColor(c);
+}
+
+// straight lines are spans; anything else is Bresenham a pixel at a time
+void DrawCanvasLine(PixelCanvas* canvas, int x1, int y1, int x2, int y2, const Color& c) {
+	if (y1 == y2 || x1 == x2) {
+		FillCanvasRect(canvas, std::min(x1, x2), std::min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1, c);
+		return;
+	}
+	Uint32 value = CanvasColor(c);
+	Uint32* pixels = LockCanvas(canvas);
+	int dx = abs(x2 - x1), dy = -abs(y2 - y1);
+	int step_x = (x1 < x2) ? 1 : -1, step_y = (y1 < y2) ? 1 : -1;
+	int error = dx + dy;
+	for (;;) {
+		if (x1 >= 0 && y1 >= 0 && x1 < canvas->w && y1 < canvas->h)
+			pixels[y1 * canvas->w + x1] = value;
+		if (x1 == x2 && y1 == y2)
+			break;
+		int twice = 2 * error;
+		if (twice >= dy) {
+			error += dy;
+			x1 += step_x;
+		}
+		if (twice <= dx) {
+			error += dx;
+			y1 += step_y;
+		}
+	}
+}
+
+void BlitCanvas(PixelCanvas* dest, const PixelCanvas* src, int x, int y) {
+	int w = src->w, h = src->h;
+	int src_x = x, src_y = y;
+	if (!ClipToCanvas(dest, x, y, w, h))
+		return;
+	src_x = x - src_x;
+	src_y = y - src_y;
+	Uint32* pixels = LockCanvas(dest);
+	for (int row = 0; row < h; row++)
+		BlitSpan(pixels + (y + row) * dest->w + x, src->pixels + (src_y + row) * src->w + src_x, w);
+}
+
+/* The game keeps drawing into pixels while the render thread uploads, so each draw
+* list gets its own copy: staged[i] is what draw_lists[i] shows. It's only copied when
+* the canvas has changed since, and only uploaded when it differs from the texture.
+*/
+void DrawCanvas(PixelCanvas* canvas, int x, int y) {
+	int staged = sys.recording;
+	if (canvas->staged_version[staged] != canvas->version) {
+		memcpy(canvas->staged[staged], canvas->pixels, canvas->w * canvas->h * sizeof(Uint32));
+		canvas->staged_version[staged] = canvas->version;
+	}
+	DrawCommand* command = RecordCommand(OpCopy, 0, 0, 0);
+	if (command == NULL)
+		return;
+	command->texture = canvas->texture;
+	command->canvas = canvas;
+	command->src = { 0, 0, canvas->w, canvas->h };
+	command->dest = { x, y, canvas->w, canvas->h };
 }
 
 static unsigned char LookupKeysym(SDL_Keycode sym);
@@ -399,9 +977,22 @@ static void RefreshKeys() {
 
 }
 
+// hands the frame to the render thread; only waits if the one before hasn't been presented yet
 void Refresh() {
-	SDL_RenderPresent(sys.renderer);
+	{
+		std::unique_lock<std::mutex> lock(sys.render_mutex);
+		sys.render_done.wait(lock, [] { return !sys.frame_pending; });
+		sys.recording = 1 - sys.recording;
+		sys.frame_pending = true;
+	}
+	sys.render_wake.notify_one();
+	sys.draw_lists[sys.recording]->count = 0;
+	sys.draw_lists[sys.recording]->overflowed = false;
 	RefreshKeys();
+	if (!sys.first_frame_traced) {
+		sys.first_frame_traced = true;
+		TraceStartup("first frame", "", SDL_GetPerformanceCounter() - sys.start_counter);
+	}
 }
 
 const char MinusKey = '-', EqualsKey = '=', BackQuoteKey = '`', LeftBracketKey = '[', RightBracketKey = ']',
@@ -464,6 +1055,11 @@ void Sleep(int ms) {
 	SDL_Delay(ms);
 }
 
+// high resolution time since InitSystem, use this for timers instead of counting frames
+double GetMilliseconds() {
+	return (double)(SDL_GetPerformanceCounter() - sys.start_counter) * sys.counter_ms;
+}
+
 bool IsRunning() {
 	return sys.running;
 }
@@ -483,8 +1079,12 @@ static int RenderChar(int character, int x, int y, FontBank* font) {
 	dest.y = y;
 	dest.w = font->src_rects[character].w;
 	dest.h = font->src_rects[character].h;
-	SDL_RenderCopy(sys.renderer, font->texture, &font->src_rects[character],
-		&dest);
+	DrawCommand* command = RecordCommand(OpCopy, 0, 0, 0);
+	if (command != NULL) {
+		command->texture = font->texture;
+		command->src = font->src_rects[character];
+		command->dest = dest;
+	}
 	return font->src_rects[character].w;
 }
 
@@ -505,27 +1105,44 @@ static void RenderText(const char* str, int x, int y, FontBank* font) {
 }
 
 void WriteString(const char* s, int x1, int y1) {
-	RenderText(s, x1, y1, &sys.default_font);
+	RenderText(s, x1, y1, GetDefaultFont());
 }
 
 void WriteInt(int n, int x1, int y1) {
-	std::stringstream out;
-	out << n;
-	WriteString(out.str().c_str(), x1, y1);
+	char digits[16];
+	WriteString(FormatInt(digits, sizeof(digits), n).data(), x1, y1);	// 0-terminated, like all TextBuffers
 }
 
 void WriteChar(char c, int x1, int y1) {
-	RenderChar(c, x1, y1, &sys.default_font);
+	RenderChar(c, x1, y1, GetDefaultFont());
 }
 
+// waits for the font thread the first time, then makes its surface a texture
+static FontBank* GetDefaultFont() {
+	if (!sys.font_ready) {
+		sys.font_thread.join();
+		if (sys.font_failed)
+			exit(0);
+		TraceStartup("font", "(on its own thread)", sys.font_counts);
+		CallOnRenderThread([] { sys.default_font.texture = SDL_CreateTextureFromSurface(sys.renderer, sys.font_surface); });
+		SDL_FreeSurface(sys.font_surface);
+		sys.font_surface = NULL;
+		sys.font_ready = true;
+	}
+	return &sys.default_font;
+}
+
+// runs on the font thread, so it only makes a surface, in sys.font_surface, and
+// GetDefaultFont makes the texture
 static void CreateFontBank(FontBank* fb, const char* fontName, int pointSize, SDL_Color color) {
-	// here we actually create a texture containing all the characters we'll need and store
+	// here we actually create an image containing all the characters we'll need and store
 	// it with a bunch of info on the dimensions and location of each character in the font bank
 	TTF_Font* font = TTF_OpenFont(fontName, pointSize);
 	if (font == NULL) {
-		err_log << "Couldn't open font " << fontName << std::endl;
-		err_log.flush();
-		exit(0);
+		WriteLog("Couldn't open font:");
+		WriteLog(fontName);
+		sys.font_failed = true;
+		return;
 	}
 	int font_height = TTF_FontHeight(font);
 	fb->height = font_height;
@@ -539,8 +1156,7 @@ static void CreateFontBank(FontBank* fb, const char* fontName, int pointSize, SD
 		text[0] = (char)i;
 		int return_code = TTF_SizeText(font, text, &w, &h);
 		if (return_code == -1)
-			err_log << "Font: Got a bad return code on " << i << std::endl;
-		// else err_log << "Font: OK return code..." << w << "," << h << std::endl;
+			WriteLog("Font: Got a bad return code on a character.");
 		fb->src_rects[i].w = w;
 		fb->src_rects[i].h = h;
 		fb->src_rects[i].x = running_x;
@@ -560,8 +1176,6 @@ static void CreateFontBank(FontBank* fb, const char* fontName, int pointSize, SD
 	SDL_Surface* temp_surface = SDL_CreateRGBSurface(0,
 		running_x, font_height, bpp, Rmask, Gmask, Bmask, Amask);
 
-	err_log << "Font w/h:" << running_x << " " << font_height << std::endl;
-
 	Uint32 TransparentColor = SDL_MapRGBA(temp_surface->format, color.r, color.g, color.b, 0);
 	SDL_FillRect(temp_surface, NULL, TransparentColor);
 	for (int i = 0; i < 256; i++) {
@@ -572,8 +1186,7 @@ static void CreateFontBank(FontBank* fb, const char* fontName, int pointSize, SD
 		SDL_BlitSurface(one_letter, NULL, temp_surface, &(fb->src_rects[i]));
 		SDL_FreeSurface(one_letter);
 	}
-	fb->texture = SDL_CreateTextureFromSurface(sys.renderer, temp_surface);
-	SDL_FreeSurface(temp_surface);
+	sys.font_surface = temp_surface;
 	TTF_CloseFont(font);
 }
 
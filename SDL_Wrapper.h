@@ -24,6 +24,21 @@ struct Image {
 	int				x, y, w, h;
 };
 
+/* PixelCanvas: an image you draw into pixel by pixel. The drawing is all done in memory,
+* so a frame of procedural drawing costs one texture upload instead of a driver call
+* per pixel; DrawCanvas puts it on screen, uploading it first if it changed since.
+* Pixels are 0xAARRGGBB.
+*/
+struct PixelCanvas {
+	SDL_Texture*	texture;			// streaming, owned by the render thread
+	int				w, h;
+	Uint32*			pixels;				// w * h, row after row
+	Uint32*			staged[2];			// what each draw list shows; see DrawCanvas
+	unsigned int	version;			// goes up with every change to pixels
+	unsigned int	staged_version[2];
+	unsigned int	uploaded_version;
+};
+
 struct Music {
 	struct _Mix_Music*  music_chunk;
 };
@@ -73,10 +88,23 @@ Image CropImage(Image& im, unsigned int x, unsigned int y, unsigned int w, unsig
 void DrawImage(Image& im, int x, int y);
 void FillRect(int x, int y, int w, int h, const Color& c);
 
+// freed by CloseSystem, like images; NULL if there's no room for another
+PixelCanvas* CreateCanvas(int w, int h);
+Uint32 CanvasColor(const Color& c);
+// for writing pixels directly; counts as changing the canvas
+Uint32* LockCanvas(PixelCanvas* canvas);
+void FillCanvasRect(PixelCanvas* canvas, int x, int y, int w, int h, const Color& c);
+void DrawCanvasPixel(PixelCanvas* canvas, int x, int y, const Color& c);
+void DrawCanvasLine(PixelCanvas* canvas, int x1, int y1, int x2, int y2, const Color& c);
+// copies src in at x, y, skipping magenta pixels the way images' color key does
+void BlitCanvas(PixelCanvas* dest, const PixelCanvas* src, int x, int y);
+void DrawCanvas(PixelCanvas* canvas, int x, int y);
+
 bool WasKeyPressed(char c);
 bool IsKeyDown(char c);
 
 void Sleep(int ms);
+double GetMilliseconds();
 
 bool IsRunning();
 
@@ -0,0 +1,322 @@
+#include "Shards.h"
+
+#include "Simulator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+#define CHECKPOINT_MAGIC	0x4B43424Au		// "JBCK"
+#define CHECKPOINT_VERSION	3
+#define ROUNDS_PER_CHUNK	1000000			// rounds between looks at the clock
+#define CLAIM_SETTLE_MS		2000			// how long a taken-over lock has to stay ours
+
+struct Job {
+	int			rules;
+	long long	num_rounds;
+	int			num_shards;
+	uint64_t	seed;
+};
+
+// written to disk as is, so only the same build of the program can read it back
+struct ShardState {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	size;
+	long long	rounds_done;
+	long long	rounds_total;
+	Deck		deck;
+	int			num_decks;
+	int			cut_card;
+	uint64_t	seed;
+	long long	shoes_used;
+	int			next_shoe;
+	SimStats	stats;
+};
+
+static string ShardPath(const char* dir, int shard, const char* kind) {
+	stringstream path;
+	path << dir << "/shard_" << shard << "." << kind;
+	return path.str();
+}
+
+static long long ShardRounds(const Job& job, int shard) {
+	return job.num_rounds / job.num_shards + (shard < job.num_rounds % job.num_shards ? 1 : 0);
+}
+
+static bool ReadJob(const char* dir, Job& job) {
+	ifstream in(string(dir) + "/job.txt");
+	string key, rules;
+	in >> key >> rules >> key >> job.num_rounds >> key >> job.num_shards >> key >> job.seed;
+	job.rules = FindRuleSet(rules);
+	if (!in || job.rules < 0 || job.num_shards < 1 || job.num_shards > job.num_rounds) {
+		cout << "Couldn't read a job from " << dir << endl;
+		return false;
+	}
+	return true;
+}
+
+bool CreateJob(const char* dir, const char* rule_set, long long num_rounds, int num_shards, uint64_t seed) {
+	// every shard needs a round at least, or it would have nothing to finish
+	if (FindRuleSet(rule_set) < 0 || num_rounds < 1 || num_shards < 1 || num_shards > num_rounds) {
+		cout << "Need a rule set (standard, h17, 6to5 or nofrills), rounds and shards, and no more shards than rounds." << endl;
+		return false;
+	}
+	error_code error;
+	fs::create_directories(dir, error);
+	ofstream out(string(dir) + "/job.txt");
+	out << "rules " << rule_set << endl << "rounds " << num_rounds << endl
+		<< "shards " << num_shards << endl << "seed " << seed << endl;
+	return (bool)out;
+}
+
+/* CHECKPOINTS */
+
+static bool LoadState(const string& path, ShardState& state) {
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+		return false;
+	bool ok = fread(&state, sizeof(state), 1, f) == 1;
+	fclose(f);
+	return ok && state.magic == CHECKPOINT_MAGIC && state.version == CHECKPOINT_VERSION && state.size == sizeof(state);
+}
+
+// writes next to the real file and renames over it, so a crash mid-write leaves the old one
+static bool SaveState(const string& path, const ShardState& state) {
+	string temp = path + ".tmp";
+	FILE* f = fopen(temp.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	bool ok = fwrite(&state, sizeof(state), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	error_code error;
+	if (ok)
+		fs::rename(temp, path, error);
+	return ok && !error;
+}
+
+/* LOCKS */
+
+static string ReadToken(const string& path) {
+	ifstream in(path);
+	string token;
+	in >> token;
+	return token;
+}
+
+// create: fails if the lock's already there ("x" is atomic); otherwise the token is
+// written next to it and renamed over it, so a reader never sees half a token
+static bool WriteToken(const string& path, const string& token, bool create) {
+	string target = create ? path : path + "." + token + ".tmp";
+	FILE* f = fopen(target.c_str(), create ? "wx" : "w");
+	if (f == NULL)
+		return false;
+	fputs(token.c_str(), f);
+	bool ok = fclose(f) == 0;
+	if (create)
+		return ok;
+	error_code error;
+	if (ok)
+		fs::rename(target, path, error);
+	return ok && !error;
+}
+
+static bool IsStale(const string& path) {
+	error_code error;
+	fs::file_time_type touched = fs::last_write_time(path, error);
+	return !error && fs::file_time_type::clock::now() - touched >= chrono::seconds(LOCK_TIMEOUT_SECONDS);
+}
+
+/* Taking over a stale lock can race: two workers can both see it stale, and the second
+* one's rename can catch the lock the first has just made. So whoever renamed a lock that
+* turns out to be fresh puts it back, and a takeover only counts if the token is still
+* ours CLAIM_SETTLE_MS later. That narrows the window without closing it, and KeepLock's
+* read-then-write has one too: two workers can end up on the same shard for a while.
+* Until the next checkpoint shows one of them the other's token, at worst; and since a
+* shard plays the same rounds from the same seed whoever runs it, every checkpoint and
+* the .done file are right either way. Only time is lost.
+*/
+static bool ClaimShard(const string& lock, const string& token) {
+	if (WriteToken(lock, token, true))
+		return true;
+	if (!IsStale(lock))
+		return false;
+	string taken = lock + "." + token;
+	error_code error;
+	fs::rename(lock, taken, error);
+	if (error)
+		return false;
+	if (!IsStale(taken)) {
+		// somebody claimed it between our look and our rename; give it back
+		WriteToken(lock, ReadToken(taken), true);
+		fs::remove(taken, error);
+		return false;
+	}
+	fs::remove(taken, error);
+	if (!WriteToken(lock, token, true))
+		return false;
+	this_thread::sleep_for(chrono::milliseconds(CLAIM_SETTLE_MS));
+	return ReadToken(lock) == token;
+}
+
+// refreshes the lock so nobody takes it over; false if somebody already has
+static bool KeepLock(const string& lock, const string& token) {
+	if (ReadToken(lock) != token)
+		return false;
+	return WriteToken(lock, token, false);
+}
+
+/* RUNNING SHARDS */
+
+static bool SaveCheckpoint(const string& path, ShardState& state, const Shoe& shoe) {
+	state.deck = shoe.deck;
+	state.num_decks = shoe.num_decks;
+	state.cut_card = shoe.cut_card;
+	state.seed = shoe.seed;
+	state.shoes_used = shoe.shoes_used;
+	state.next_shoe = shoe.next_shoe;
+	return SaveState(path, state);
+}
+
+// plays the shard from its checkpoint (if there is one) to the end; true once its .done
+// file is written, false if it lost the lock or couldn't write
+static bool RunShard(const char* dir, const Job& job, int shard, const string& token) {
+	string lock = ShardPath(dir, shard, "lock");
+	string checkpoint = ShardPath(dir, shard, "checkpoint");
+	ShardState* state = new ShardState;
+	Shoe* shoe = new Shoe;
+	if (LoadState(checkpoint, *state)) {
+		InitializeShoe(*shoe, state->seed, state->num_decks);
+		shoe->deck = state->deck;
+		shoe->cut_card = state->cut_card;
+		shoe->shoes_used = state->shoes_used;
+		shoe->next_shoe = state->next_shoe;
+		RefillBatch(*shoe);
+		cout << "Shard " << shard << ": resuming after " << state->rounds_done << " rounds" << endl;
+	}
+	else {
+		state->magic = CHECKPOINT_MAGIC;
+		state->version = CHECKPOINT_VERSION;
+		state->size = sizeof(ShardState);
+		state->rounds_done = 0;
+		state->rounds_total = ShardRounds(job, shard);
+		InitializeSimStats(state->stats);
+		InitializeShoe(*shoe, job.seed + shard * SEED_STRIDE);
+	}
+
+	bool ours = true;
+	auto last_save = chrono::steady_clock::now();
+	while (ours && state->rounds_done < state->rounds_total) {
+		long long chunk = state->rounds_total - state->rounds_done;
+		if (chunk > ROUNDS_PER_CHUNK)
+			chunk = ROUNDS_PER_CHUNK;
+		CallWithRules(job.rules, [&](auto rules) {
+			Simulate<decltype(rules)>(state->stats, *shoe, chunk);
+		});
+		state->rounds_done += chunk;
+		// the finished state is saved below, whether or not this loop ran at all
+		if (state->rounds_done == state->rounds_total
+			|| chrono::steady_clock::now() - last_save < chrono::seconds(CHECKPOINT_SECONDS))
+			continue;
+		ours = KeepLock(lock, token);
+		if (!ours)
+			break;
+		if (!SaveCheckpoint(checkpoint, *state, *shoe))
+			cout << "Shard " << shard << ": couldn't write " << checkpoint << endl;
+		last_save = chrono::steady_clock::now();
+	}
+	bool done = false;
+	if (ours)
+		ours = KeepLock(lock, token);
+	if (ours) {
+		error_code error;
+		if (SaveCheckpoint(checkpoint, *state, *shoe)) {
+			fs::rename(checkpoint, ShardPath(dir, shard, "done"), error);
+			done = !error;
+		}
+		// let go either way, so a worker that can write picks it up
+		fs::remove(lock, error);
+		if (done)
+			cout << "Shard " << shard << ": done" << endl;
+		else cout << "Shard " << shard << ": couldn't write its results to " << dir << endl;
+	}
+	else cout << "Shard " << shard << ": another worker took it over" << endl;
+	delete shoe;
+	delete state;
+	return done;
+}
+
+void WorkJob(const char* dir) {
+	Job job;
+	if (!ReadJob(dir, job))
+		return;
+	random_device random;
+	stringstream token;
+	token << hex << random() << random() << time(NULL);
+	// keep going round while shards are getting finished; ones that were locked may
+	// have gone stale since. A shard that fails doesn't count, so it can't keep us here
+	bool worked = true;
+	while (worked) {
+		worked = false;
+		for (int shard = 0; shard < job.num_shards; shard++) {
+			if (fs::exists(ShardPath(dir, shard, "done")))
+				continue;
+			if (!ClaimShard(ShardPath(dir, shard, "lock"), token.str()))
+				continue;
+			if (RunShard(dir, job, shard, token.str()))
+				worked = true;
+		}
+	}
+}
+
+void RunJob(const char* exe, const char* dir, int num_workers) {
+	if (num_workers < 1)
+		num_workers = (int)thread::hardware_concurrency();
+	stringstream command;
+	command << "\"" << exe << "\" -job-work \"" << dir << "\"";
+#ifdef _WIN32
+	// cmd /c strips the outermost quotes when there's more than one pair
+	string line = "\"" + command.str() + "\"";
+#else
+	string line = command.str();
+#endif
+	vector<thread> workers;
+	for (int i = 0; i < num_workers; i++)
+		workers.push_back(thread([line] { system(line.c_str()); }));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	MergeJob(dir);
+}
+
+bool MergeJob(const char* dir) {
+	Job job;
+	if (!ReadJob(dir, job))
+		return false;
+	SimStats* total = new SimStats;
+	ShardState* state = new ShardState;
+	InitializeSimStats(*total);
+	int missing = 0;
+	for (int shard = 0; shard < job.num_shards; shard++) {
+		if (LoadState(ShardPath(dir, shard, "done"), *state) && state->rounds_done == state->rounds_total)
+			MergeSimStats(*total, state->stats);
+		else missing++;
+	}
+	if (missing > 0)
+		cout << missing << " of " << job.num_shards << " shards aren't finished; these are the rest" << endl;
+	PrintSimStats(GetRuleSetName(job.rules), *total);
+	delete state;
+	delete total;
+	return missing == 0;
+}
@@ -0,0 +1,33 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+/* Long simulations split into shards that separate worker processes run, on this
+* machine or on several that share the job directory. Each shard checkpoints its
+* stats and shoe every CHECKPOINT_SECONDS, so a killed worker only loses the rounds
+* since its last checkpoint: the next worker to come along picks the shard back up.
+*
+* Files in the job directory:
+*   job.txt				rule set, rounds, shards and seed
+*   shard_N.lock		whoever is working on shard N; rewritten at every checkpoint,
+*						and taken over by another worker if it goes LOCK_TIMEOUT_SECONDS untouched
+*   shard_N.checkpoint	shard N so far
+*   shard_N.done		shard N's final stats
+*/
+
+#include <cstdint>
+
+#define CHECKPOINT_SECONDS		60
+#define LOCK_TIMEOUT_SECONDS	600
+
+// writes job.txt; shard i plays its share of the rounds from shoe seed + i * SEED_STRIDE
+bool CreateJob(const char* dir, const char* rule_set, long long num_rounds, int num_shards, uint64_t seed);
+
+// claims and runs shards until there's nothing left to claim
+void WorkJob(const char* dir);
+
+// starts num_workers copies of exe working on the job, waits for them, then merges
+void RunJob(const char* exe, const char* dir, int num_workers);
+
+// adds up the finished shards and prints the result; false if any aren't done yet
+bool MergeJob(const char* dir);
+#endif
@@ -0,0 +1,95 @@
+#include "Simulator.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+void InitializeShoe(Shoe& shoe, uint64_t seed, int num_decks, double penetration) {
+	FillShoe(shoe.deck, num_decks);
+	// the deck's own generator only shuffles discards back in when a round runs the shoe
+	// dry; seeding it off the shoe's seed makes that repeatable too (complemented, so it
+	// isn't shoe 0's shuffle over again)
+	SeedDeck(shoe.deck, ~seed);
+	shoe.num_decks = shoe.deck.num_cards / DECK_BYTES;
+	shoe.cut_card = (int)(penetration * shoe.deck.num_cards);
+	shoe.deck.next_card = shoe.deck.num_cards;		// so the first round starts a shoe
+	shoe.seed = seed;
+	shoe.shoes_used = 0;
+	shoe.next_shoe = SHUFFLE_BATCH;
+	shoe.mirrored = false;
+}
+
+static void ShuffleBatch(Shoe& shoe, uint64_t first_seed) {
+	if (shoe.mirrored)
+		MirrorShuffleShoes(shoe.batch, SHUFFLE_BATCH, shoe.num_decks, first_seed);
+	else ShuffleShoes(shoe.batch, SHUFFLE_BATCH, shoe.num_decks, first_seed);
+}
+
+void RefillBatch(Shoe& shoe) {
+	if (shoe.next_shoe < SHUFFLE_BATCH)
+		ShuffleBatch(shoe, shoe.seed + shoe.shoes_used - shoe.next_shoe);
+}
+
+void NextShoe(Shoe& shoe) {
+	if (shoe.next_shoe == SHUFFLE_BATCH) {
+		ShuffleBatch(shoe, shoe.seed + shoe.shoes_used);
+		shoe.next_shoe = 0;
+	}
+	LoadDeck(shoe.deck, shoe.batch + shoe.next_shoe * shoe.num_decks * DECK_BYTES, shoe.num_decks);
+	shoe.next_shoe++;
+	shoe.shoes_used++;
+}
+
+static void PrintResult(const char* name, const SimStats& stats) {
+	cout << name << ": house edge " << -100.0 * stats.returns.mean << "% +/- "
+		<< 100.0 * GetConfidence(stats.returns) << "%, standard deviation "
+		<< GetStdDev(stats.returns) << " a round" << endl;
+	cout << "  " << stats.wins << " won, " << stats.losses << " lost, " << stats.ties << " pushed" << endl;
+	cout << "  bankroll 5% " << GetPercentile(stats.bankrolls, 5) << ", median " << GetPercentile(stats.bankrolls, 50)
+		<< ", 95% " << GetPercentile(stats.bankrolls, 95) << "; drawdown median " << GetPercentile(stats.drawdowns, 50)
+		<< ", 99% " << GetPercentile(stats.drawdowns, 99) << ", worst " << stats.max_drawdown << endl;
+}
+
+// player's first two cards down the side, dealer's upcard across the top, return in %
+static void PrintOutcomes(const SimStats& stats) {
+	cout << "  total";
+	for (int u = 2; u < MATRIX_UPCARDS; u++) {
+		if (u == 11)
+			cout << setw(7) << "A";
+		else cout << setw(7) << u;
+	}
+	cout << endl << fixed << setprecision(1);
+	for (int p = 4; p < MATRIX_TOTALS; p++) {
+		cout << setw(7) << p;
+		for (int u = 2; u < MATRIX_UPCARDS; u++)
+			cout << setw(7) << 100.0 * stats.outcomes[p][u].mean;
+		cout << endl;
+	}
+	cout.unsetf(ios::floatfield);
+	cout << setprecision(6);
+}
+
+void PrintSimStats(const char* name, const SimStats& stats) {
+	PrintResult(name, stats);
+	PrintOutcomes(stats);
+}
+
+template <class Rules>
+static void RunOne(const char* name, long long num_rounds, uint64_t seed, int num_threads) {
+	SimStats* stats = new SimStats;
+	InitializeSimStats(*stats);
+	SimulateParallel<Rules>(*stats, num_rounds, seed, num_threads);
+	PrintSimStats(name, *stats);
+	delete stats;
+}
+
+void RunSimulations(long long num_rounds, uint64_t seed) {
+	if (num_rounds <= 0)
+		return;
+	int num_threads = (int)thread::hardware_concurrency();
+	RunOne<StandardRules>("Standard (S17, DAS, surrender, 3:2)", num_rounds, seed, num_threads);
+	RunOne<H17Rules>("H17", num_rounds, seed, num_threads);
+	RunOne<SixToFiveRules>("H17, blackjack pays 6:5", num_rounds, seed, num_threads);
+	RunOne<NoFrillsRules>("No frills (one split, no DAS, no surrender)", num_rounds, seed, num_threads);
+}
@@ -0,0 +1,104 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+/* Plays rounds as fast as it can with no one watching. Simulate<> is compiled
+* once per rule set, so each variant gets its own specialized inner loop.
+*/
+
+#include "Rules.h"
+#include "Strategy.h"
+#include "BulkShuffle.h"
+#include "Stats.h"
+
+#include <thread>
+#include <vector>
+
+#define DEFAULT_PENETRATION 0.7	// how far into the shoe the cut card goes
+#define SHUFFLE_BATCH 256	// shoes shuffled at a time by ShuffleDecks
+#define SEED_STRIDE (1ull << 40)	// shoe seeds each thread gets to itself
+
+// plays out a round StartRound has dealt, with basic strategy
+template <class Rules>
+void FinishRound(Round& round, Deck& deck) {
+	if (round.state == InsuranceOffer)
+		TakeInsurance<Rules>(round, false);
+	while (round.state == PlayerTurn) {
+		if (ApplyAction<Rules>(round, deck, BasicStrategy<Rules>(round)) == false)
+			ApplyAction<Rules>(round, deck, Stand);
+	}
+	if (round.state == DealerTurn)
+		PlayDealer<Rules>(round, deck);
+}
+
+/* A Shoe is where the simulator's decks come from: shoe k is the deck FillShoe and
+* SeedDeck(deck, seed + k) would shuffle to, made SHUFFLE_BATCH at a time. Everything
+* needed to carry on exactly where it left off is in deck, seed, shoes_used and
+* next_shoe; the batch can be remade. A mirrored shoe deals the antithetic partners
+* of an ordinary one's decks instead.
+*/
+
+struct Shoe {
+	Deck		deck;
+	int			num_decks;
+	int			cut_card;						// shuffle once this many cards are gone
+	uint64_t	seed;
+	long long	shoes_used;
+	int			next_shoe;						// in the batch
+	bool		mirrored;						// shuffled by MirrorShuffleShoes instead
+	uint8_t		batch[SHUFFLE_BATCH * MAX_DECKS * DECK_BYTES];
+};
+
+void InitializeShoe(Shoe& shoe, uint64_t seed, int num_decks = 1, double penetration = DEFAULT_PENETRATION);
+void RefillBatch(Shoe& shoe);		// remakes the current batch, e.g. after loading a checkpoint
+void NextShoe(Shoe& shoe);
+
+// adds num_rounds to stats (SimStats, or RunningStats for just the returns), carrying on with the shoe
+template <class Rules, class Stats>
+void Simulate(Stats& stats, Shoe& shoe, long long num_rounds) {
+	Round round;
+	for (long long n = 0; n < num_rounds; n++) {
+		if (shoe.deck.next_card >= shoe.cut_card)
+			NextShoe(shoe);
+		StartRound<Rules>(round, shoe.deck, 1.0);
+		int first_points = GetPoints(round.hands[0].cards);
+		FinishRound<Rules>(round, shoe.deck);
+		RecordRound(stats, first_points, GetCardPoints(round.dealer.cards[0]), SettleRound<Rules>(round));
+	}
+}
+
+template <class Rules>
+void Simulate(SimStats& stats, long long num_rounds, uint64_t seed) {
+	Shoe* shoe = new Shoe;
+	InitializeShoe(*shoe, seed);
+	Simulate<Rules>(stats, *shoe, num_rounds);
+	delete shoe;
+}
+
+// each thread keeps its own stats and they're merged once everyone's finished
+template <class Rules>
+void SimulateParallel(SimStats& stats, long long num_rounds, uint64_t seed, int num_threads) {
+	if (num_threads < 1)
+		num_threads = 1;
+	std::vector<SimStats*> thread_stats(num_threads);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; t++) {
+		thread_stats[t] = new SimStats;
+		InitializeSimStats(*thread_stats[t]);
+		long long rounds = num_rounds / num_threads + (t < num_rounds % num_threads ? 1 : 0);
+		SimStats* mine = thread_stats[t];
+		uint64_t thread_seed = seed + t * SEED_STRIDE;
+		threads.push_back(std::thread([=] { Simulate<Rules>(*mine, rounds, thread_seed); }));
+	}
+	for (int t = 0; t < num_threads; t++) {
+		threads[t].join();
+		MergeSimStats(stats, *thread_stats[t]);
+		delete thread_stats[t];
+	}
+}
+
+// house edge, spread, bankroll and drawdown percentiles, and the outcome matrix
+void PrintSimStats(const char* name, const SimStats& stats);
+
+// plays num_rounds under each of the built-in rule sets and prints the house edge
+void RunSimulations(long long num_rounds, uint64_t seed);
+#endif
@@ -2,45 +2,32 @@
 #include <string>
 #include <ctime>
 #include <cstdlib>
+#include <cstring>
 
 #include "SDL_Wrapper.h"
+#include "Blackjack.h"
+#include "Rules.h"
+#include "Simulator.h"
+#include "Compare.h"
+#include "Shards.h"
+#include "Sweep.h"
+#include "TableFlow.h"
+#include "TableSnapshot.h"
 
 using namespace std;
 
-/* ENUM, ARRAY AND STRUCT DEFINITIONS */
+// the rules this table is played by
+typedef StandardRules TableRules;
 
-enum GameState { PlayerTurn, DealerTurn, GameOver };
+const int BET = 10;	// chips per round; even enough for 3:2, 6:5, surrender and insurance
 
-enum Suit { Clubs, Diamonds, Hearts, Spades };
-string SuitStrings[] = { "Clubs", "Diamonds", "Hearts", "Spades" };
-
-enum   Value            {
-	Ace, Two, Three, Four, Five, Six, Seven, Eight, Nine,
-	Ten, Jack, Queen, King
-};
-string ValueStrings[] = { "Ace", "Two", "Three", "Four", "Five", "Six", "Seven", "Eight", "Nine",
-"Ten", "Jack", "Queen", "King" };
-
-struct Card {
-	Value  value;
-	Suit   suit;
-};
-
-struct Deck {
-	Card cards[52];
-	int next_card;
-};
-
-/* Hand represents a pile of cards */
-
-struct Hand {
-	int num_cards;
-	Card cards[52];	// holds UP TO 52 cards
-};
+// the table is saved here on the way out and picks up from it next time
+const char* SAVE_FILE = "Table.sav";
 
 /* GLOBALS*/
 
 Image CardImages[52];
+Image CardBack;
 
 /* FUNCTIONS */
 
@@ -55,111 +42,95 @@ void InitCardImages() {
 			slot++;
 		}
 	}
+	// the back is third along in the jokers' row
+	CardBack = CropImage(Cards, (2000 * 2) / 13, (1117 * 4) / 5, 154, 223);
 }
 
-int GetCardCode(Card c) {
-	return c.value * 4 + c.suit;
-}
-
-string CardToString(Card c) {
-	return ValueStrings[c.value] + " of " + SuitStrings[c.suit];
-}
-
-int RandInRange(int low, int high) {
-	int range = high - low + 1;
-	return (rand() % range) + low;
-}
-
-void FillDeck(Deck& deck) {
-	int slot = 0;
-	for (int value = 0; value < 13; value++) {
-		for (int suit = 0; suit < 4; suit++) {
-			deck.cards[slot].value = (Value)value;
-			deck.cards[slot].suit = (Suit)suit;
-			slot++;
-		}
-	}
-	deck.next_card = 0;
-}
-
-void PrintDeck(Deck deck) {
-	for (int i = 0; i < 52; i++)
-		cout << CardToString(deck.cards[i]) << endl;
-}
-
-void ShuffleDeck(Deck& deck) {
-	for (int i = 0; i < 52; i++) {
-		int j = RandInRange(i, 51);
-		Card temp = deck.cards[i];
-		deck.cards[i] = deck.cards[j];
-		deck.cards[j] = temp;
-	}
-	deck.next_card = 0;
-}
-
-Card DealCard(Deck& deck) {
-	Card out = deck.cards[deck.next_card];
-	deck.next_card++;
-	return out;
-}
-
-
-void InitializeHand(Hand& cs) {
-	// what would be good starting values for each member of the struct?
-	cs.num_cards = 0;
-}
-
-void AddCardToHand(Hand& cs, Card cardToAdd) {
-	// what needs to happen when we add a card to a card stack?
-	cs.cards[cs.num_cards] = cardToAdd;
-	cs.num_cards++;
-
-}
-
-void DrawHand(const Hand& cs, int x, int y) {
+void DrawHand(const Hand& cs, int x, int y, bool hide_hole_card = false) {
 	// should draw a stack of cards starting at x,y and going diagonally down...
 	for (int i = 0; i < cs.num_cards; i++) {
 		Image img = CardImages[GetCardCode(cs.cards[i])];
+		if (hide_hole_card && i == 1)
+			img = CardBack;
 		DrawImage(img, x, y);
 		x += 20;
 		y += 20;
 	}
 }
 
-int GetPoints(Hand hand) {
-	int points = 0;
-	int ace_count = 0;
-	for (int i = 0; i < hand.num_cards; i++) {
-		Card c = hand.cards[i];
-		switch (c.value) {
-		case Ace:
-			points += 11;
-			ace_count++;
-			break;
-		case Jack:
-		case Queen:
-		case King:
-			points += 10;
-			break;
-		default:
-			points += 1 + c.value;
-			break;
-		}
+// adds each hand's result to the table's tally and returns the chips won or lost overall
+double ScoreRound(Table& table) {
+	const Round& round = table.round;
+	for (int i = 0; i < round.num_hands; i++) {
+		double result = HandResult<TableRules>(round, i);
+		if (result > 0)
+			table.wins++;
+		else if (result < 0)
+			table.losses++;
+		else table.ties++;
 	}
-	while (points > 21 && ace_count > 0) {
-		points -= 10;
-		ace_count--;
-	}
-	return points;
+	double net = SettleRound<TableRules>(round);
+	table.chips += net;
+	return net;
 }
 
+/* TIMING */
+
+// the table is simulated in fixed steps so it plays the same no matter how fast we draw;
+// a step is one tick of the timer wheel
+const double UPDATE_STEP_MS = 10.0;
+// after a long stall (window drag, debugger...) don't try to catch up more than this
+const double MAX_FRAME_MS = 250.0;
+// how long the dealer waits before their first card, and between cards
+const double DEALER_TURN_DELAY_MS = 1800.0;
+const double DEALER_DRAW_DELAY_MS = 500.0;
+
 // cacophony
 int main(int argc, char ** argv) {
-	InitSystem(1280, 720);
 	srand(time(NULL));
+	// Blackjack.exe -simulate 1000000 > results.txt plays that many rounds per rule set, no window
+	if (argc > 2 && strcmp(argv[1], "-simulate") == 0) {
+		RunSimulations(atoll(argv[2]), time(NULL));
+		return 0;
+	}
+	// Blackjack.exe -compare standard h17 10000000 plays both against the same cards (see Compare.h)
+	if (argc > 4 && strcmp(argv[1], "-compare") == 0) {
+		RunComparison(argv[2], argv[3], atoll(argv[4]), time(NULL));
+		return 0;
+	}
+	// long runs: split into shards that worker processes checkpoint as they go (see Shards.h)
+	if (argc > 5 && strcmp(argv[1], "-job-create") == 0) {
+		uint64_t seed = (argc > 6) ? strtoull(argv[6], NULL, 10) : time(NULL);
+		return CreateJob(argv[2], argv[3], atoll(argv[4]), atoi(argv[5]), seed) ? 0 : 1;
+	}
+	if (argc > 2 && strcmp(argv[1], "-job-work") == 0) {
+		WorkJob(argv[2]);
+		return 0;
+	}
+	if (argc > 2 && strcmp(argv[1], "-job-run") == 0) {
+		RunJob(argv[0], argv[2], (argc > 3) ? atoi(argv[3]) : 0);
+		return 0;
+	}
+	if (argc > 2 && strcmp(argv[1], "-job-merge") == 0)
+		return MergeJob(argv[2]) ? 0 : 1;
+	// Blackjack.exe -sweep cache 10000000 decks=1,6 pays=3:2,6:5 ... (see Sweep.h); fixed seed so the cache hits
+	if (argc > 3 && strcmp(argv[1], "-sweep") == 0) {
+		SweepGrid grid;
+		InitializeSweepGrid(grid);
+		for (int i = 4; i < argc; i++) {
+			if (!ParseSweepOption(grid, argv[i])) {
+				cout << "Don't understand " << argv[i] << endl;
+				return 1;
+			}
+		}
+		RunSweep(argv[2], grid, atoll(argv[3]), 1);
+		return 0;
+	}
+
+	InitSystem(1280, 720);
 
 	InitCardImages();
-	
+
 	Sound intro = LoadSound("NewGame.wav");
 	Sound deal_card = LoadSound("DealCard.wav");
 	Sound next_turn = LoadSound("NextTurn.wav");
@@ -168,119 +139,119 @@ int main(int argc, char ** argv) {
 	Music popStyle = LoadMusic("PopStyle.mp3");
 	PlaySound(intro);
 	PlayMusic(popStyle,2);
-	Deck deck;
-	FillDeck(deck);
-	ShuffleDeck(deck);
-
-	Hand playerHand, dealerHand;
-	InitializeHand(dealerHand);
-	InitializeHand(playerHand);
-
-	GameState state = PlayerTurn;
-	int delay = 0;
-	int wins = 0, losses = 0,ties=0;
+	TimerWheel wheel;
+	InitializeTimerWheel(wheel);
+	Table table;
+	InitializeTable(table, wheel, BET, (uint64_t)(DEALER_TURN_DELAY_MS / UPDATE_STEP_MS),
+		(uint64_t)(DEALER_DRAW_DELAY_MS / UPDATE_STEP_MS));
+	TableSnapshot saved;
+	if (LoadSnapshotFile(SAVE_FILE, saved))
+		RestoreTable<TableRules>(table, saved);
+	else StartTable<TableRules>(table);
+	const Round& round = table.round;
+
+	double previous_time = GetMilliseconds();
+	double lag_ms = 0;
 	FillRect(0, 0, 1280, 720, DarkBlue);
 	while (IsKeyDown('q') == false) {
-		if (state == PlayerTurn) {
-			// check if space was pressed; if so, deal a card from the deck 
-			// and add it to the stack
-			if (WasKeyPressed(SpaceKey)) {
-				Card c = DealCard(deck);
-				PlaySound(deal_card);
-				AddCardToHand(playerHand, c);
-			}
-			if (WasKeyPressed('d')) {
-				state = DealerTurn;
-				delay = 180; // --STEVE
-				PlaySound(next_turn);
-			}
-			if (GetPoints(playerHand)>21){
-				WriteString("Bust", 220, 30);
-				PlaySound(next_turn);
-			}
+		double now = GetMilliseconds();
+		double frame_ms = now - previous_time;
+		previous_time = now;
+		if (frame_ms > MAX_FRAME_MS)
+			frame_ms = MAX_FRAME_MS;
+		lag_ms += frame_ms;
+
+		// Input: key presses only last until the next Refresh(), so handle them once per frame;
+		// the table's flow picks up wherever it was waiting
+		if (round.state == InsuranceOffer) {
+			if (WasKeyPressed('y'))
+				SendInput(table, InputYes);
+			else if (WasKeyPressed('n'))
+				SendInput(table, InputNo);
+		}
+		else if (round.state == PlayerTurn) {
+			if (WasKeyPressed(SpaceKey))
+				SendInput(table, InputHit);
+			else if (WasKeyPressed('d'))
+				SendInput(table, InputStand);
+			else if (WasKeyPressed('x'))
+				SendInput(table, InputDouble);
+			else if (WasKeyPressed('s'))
+				SendInput(table, InputSplit);
+			else if (WasKeyPressed('r'))
+				SendInput(table, InputSurrender);
+		}
+		else if (round.state == GameOver) {
+			// if they press space, shuffle up and deal the next round
+			if (WasKeyPressed(SpaceKey))
+				SendInput(table, InputDeal);
 		}
-		if (state == DealerTurn) {
-			delay--;
-			if (delay <= 0) {
-				if (GetPoints(dealerHand) < 17) {
-					Card c = DealCard(deck);
-					PlaySound(deal_card);
-					AddCardToHand(dealerHand, c);
-					delay = 50;
-				}
-				else {
-					state = GameOver;
-					if (GetPoints(playerHand) > 21)
-						losses++;
-					else if (GetPoints(playerHand) > 21) {
-						losses++;
-						PlaySound(you_lost);
-
-					}
-					else if (GetPoints(dealerHand) > 21) {
-						wins++;
-						PlaySound(you_win);
-
-					}
-					// else if (the dealer TIED OR BEAT the player)...
-					else if (GetPoints(dealerHand) == GetPoints(playerHand)){
-						ties++;
-					}
-					//             give the player a loss
-					else if (GetPoints(dealerHand) >GetPoints(playerHand) && GetPoints(dealerHand) != GetPoints(playerHand)){
-						losses++;
-						PlaySound(you_lost);
-
-					}
-					// else player gets a win.
-					else if (GetPoints(dealerHand) < GetPoints(playerHand)){
-						wins++;
-						PlaySound(you_win);
 
-					}
-				}
-			}
+		// Update: run as many fixed steps as the time that passed calls for; the wheel
+		// wakes the dealer when their pause is up
+		while (lag_ms >= UPDATE_STEP_MS) {
+			lag_ms -= UPDATE_STEP_MS;
+			AdvanceTimerWheel(wheel, wheel.now + 1);
 		}
-		if (state == GameOver) {
-			// if they press space, go back to PlayerTurn, but:
-			if (WasKeyPressed(SpaceKey)) {
-				state = PlayerTurn;
-				//   Shuffle the Deck;
-				ShuffleDeck(deck);
-				//   Reinitialize both the player and dealer's hands;
-				InitializeHand(playerHand);
-				InitializeHand(dealerHand);
-				//   Set the game state to Player's turn;
-				state = PlayerTurn;
-				//   Set delay to 0.
-				delay = 0;
-			}
+
+		if (table.events & TABLE_DEALT_CARD)
+			PlaySound(deal_card);
+		if (table.events & TABLE_DEALER_TURN)
+			PlaySound(next_turn);
+		if (table.events & TABLE_ROUND_OVER) {
+			double net = ScoreRound(table);
+			if (net > 0)
+				PlaySound(you_win);
+			else if (net < 0)
+				PlaySound(you_lost);
 		}
+		table.events = 0;
 
-		// Draw
+		// Draw: whatever the latest update left us with, at display rate
 		FillRect(0, 0, 1280, 720, DarkBlue);
-		DrawHand(playerHand, 50, 50);
-		WriteInt(GetPoints(playerHand), 210, 30);
-		DrawHand(dealerHand, 550, 50);
-		WriteInt(GetPoints(dealerHand), 500, 30);
+		bool hole_card_hidden = (round.state == InsuranceOffer || round.state == PlayerTurn);
+		DrawHand(round.dealer, 550, 50, hole_card_hidden);
+		if (hole_card_hidden)
+			WriteInt(GetCardPoints(round.dealer.cards[0]), 500, 30);
+		else WriteInt(GetPoints(round.dealer), 500, 30);
+		if (GetPoints(round.dealer)>21){
+			WriteString("Bust", 700, 30);
+		}
+		for (int i = 0; i < round.num_hands; i++) {
+			const PlayerHand& hand = round.hands[i];
+			int x = 50 + 310 * i;
+			DrawHand(hand.cards, x, 420);
+			WriteInt(GetPoints(hand.cards), x + 160, 380);
+			if (hand.surrendered)
+				WriteString("Surrender", x, 380);
+			else if (GetPoints(hand.cards) > 21)
+				WriteString("Bust", x, 380);
+			else if (hand.doubled)
+				WriteString("Double", x, 380);
+			if (round.state == PlayerTurn && i == round.current)
+				WriteString(">", x - 30, 480);
+		}
 		WriteString("Wins: ", 0, 0);
-		WriteInt(wins, 120, 0);
+		WriteInt(table.wins, 120, 0);
 		WriteString("Ties: ", 240, 0);
-		WriteInt(ties, 360, 0);
+		WriteInt(table.ties, 360, 0);
 		WriteString("Losses: ",480, 0);
-		WriteInt(losses, 600, 0);
-		if (GetPoints(playerHand)>21){
-			WriteString("Bust", 250, 30);
-		}
-		if (GetPoints(dealerHand)>21){
-			WriteString("Bust", 700, 30);
-		}
-		// maybe draw the deck too?? (face down of course)
-		// write a message: Space to hit, enter to stay
-		Refresh();
-		Sleep(10);
+		WriteInt(table.losses, 600, 0);
+		WriteString("Chips: ", 760, 0);
+		WriteInt((int)table.chips, 880, 0);
+		if (round.state == InsuranceOffer)
+			WriteString("Insurance? Y / N", 0, 675);
+		else if (round.state == PlayerTurn)
+			WriteString("Space: hit  D: stand  X: double  S: split  R: surrender", 0, 675);
+		else if (round.state == GameOver)
+			WriteString("Space: deal again", 0, 675);
+		Refresh();	// hands the frame to the render thread; waits only if it's a frame behind
+		Sleep(1);	// ...so yield rather than spin
 	}
 
+	if (SaveTable(table, saved))
+		SaveSnapshotFile(SAVE_FILE, saved);
+	DestroyTable(table);
 	CloseSystem();
 	return 0;
-}
\ No newline at end of file
+}
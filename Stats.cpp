@@ -0,0 +1,190 @@
+#include "Stats.h"
+
+#include <cmath>
+#include <cstring>
+
+/* RUNNING STATS */
+
+void InitializeStats(RunningStats& stats) {
+	stats.count = 0;
+	stats.mean = 0;
+	stats.m2 = 0;
+	stats.min = 0;
+	stats.max = 0;
+}
+
+void RecordStat(RunningStats& stats, double x) {
+	stats.count++;
+	double delta = x - stats.mean;
+	stats.mean += delta / stats.count;
+	stats.m2 += delta * (x - stats.mean);
+	if (stats.count == 1 || x < stats.min)
+		stats.min = x;
+	if (stats.count == 1 || x > stats.max)
+		stats.max = x;
+}
+
+// Chan et al.'s pairwise combination of two Welford accumulators
+void MergeStats(RunningStats& into, const RunningStats& from) {
+	if (from.count == 0)
+		return;
+	if (into.count == 0) {
+		into = from;
+		return;
+	}
+	long long count = into.count + from.count;
+	double delta = from.mean - into.mean;
+	into.mean += delta * from.count / count;
+	into.m2 += from.m2 + delta * delta * ((double)into.count * from.count / count);
+	into.count = count;
+	if (from.min < into.min)
+		into.min = from.min;
+	if (from.max > into.max)
+		into.max = from.max;
+}
+
+double GetVariance(const RunningStats& stats) {
+	if (stats.count < 2)
+		return 0;
+	return stats.m2 / (stats.count - 1);
+}
+
+double GetStdDev(const RunningStats& stats) {
+	return sqrt(GetVariance(stats));
+}
+
+double GetConfidence(const RunningStats& stats, double z) {
+	if (stats.count < 2)
+		return 0;
+	return z * sqrt(GetVariance(stats) / stats.count);
+}
+
+/* HISTOGRAM */
+
+static int HighestBit(uint64_t x) {
+	int bit = 0;
+	if (x >> 32) { x >>= 32; bit += 32; }
+	if (x >> 16) { x >>= 16; bit += 16; }
+	if (x >> 8) { x >>= 8; bit += 8; }
+	if (x >> 4) { x >>= 4; bit += 4; }
+	if (x >> 2) { x >>= 2; bit += 2; }
+	if (x >> 1) bit += 1;
+	return bit;
+}
+
+// each power of two from HISTOGRAM_LINEAR up is shifted down to its top HISTOGRAM_BITS bits
+static int BucketIndex(uint64_t magnitude) {
+	if (magnitude < HISTOGRAM_LINEAR)
+		return (int)magnitude;
+	int shift = HighestBit(magnitude) - (HISTOGRAM_BITS - 1);
+	return HISTOGRAM_LINEAR + (shift - 1) * (HISTOGRAM_LINEAR / 2)
+		+ (int)(magnitude >> shift) - HISTOGRAM_LINEAR / 2;
+}
+
+static uint64_t BucketLowest(int bucket) {
+	if (bucket < HISTOGRAM_LINEAR)
+		return (uint64_t)bucket;
+	int shift = (bucket - HISTOGRAM_LINEAR) / (HISTOGRAM_LINEAR / 2) + 1;
+	uint64_t top = (bucket - HISTOGRAM_LINEAR) % (HISTOGRAM_LINEAR / 2) + HISTOGRAM_LINEAR / 2;
+	return top << shift;
+}
+
+void InitializeHistogram(Histogram& hist) {
+	hist.count = 0;
+	memset(hist.positive, 0, sizeof(hist.positive));
+	memset(hist.negative, 0, sizeof(hist.negative));
+}
+
+void RecordValue(Histogram& hist, long long value) {
+	hist.count++;
+	if (value >= 0)
+		hist.positive[BucketIndex((uint64_t)value)]++;
+	else hist.negative[BucketIndex(0 - (uint64_t)value)]++;
+}
+
+void MergeHistograms(Histogram& into, const Histogram& from) {
+	into.count += from.count;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		into.positive[i] += from.positive[i];
+		into.negative[i] += from.negative[i];
+	}
+}
+
+// walks up from the most negative bucket; values are reported rounded toward zero
+long long GetPercentile(const Histogram& hist, double percent) {
+	if (hist.count == 0)
+		return 0;
+	long long target = (long long)ceil(percent / 100.0 * hist.count);
+	if (target < 1)
+		target = 1;
+	long long seen = 0;
+	for (int i = HISTOGRAM_BUCKETS - 1; i >= 0; i--) {
+		seen += hist.negative[i];
+		if (seen >= target)
+			return -(long long)BucketLowest(i);
+	}
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += hist.positive[i];
+		if (seen >= target)
+			return (long long)BucketLowest(i);
+	}
+	return (long long)BucketLowest(HISTOGRAM_BUCKETS - 1);
+}
+
+/* SIM STATS */
+
+void InitializeSimStats(SimStats& stats) {
+	stats.wins = 0;
+	stats.losses = 0;
+	stats.ties = 0;
+	InitializeStats(stats.returns);
+	stats.bankroll = 0;
+	stats.peak = 0;
+	InitializeHistogram(stats.bankrolls);
+	InitializeHistogram(stats.drawdowns);
+	stats.max_drawdown = 0;
+	for (int p = 0; p < MATRIX_TOTALS; p++) {
+		for (int u = 0; u < MATRIX_UPCARDS; u++)
+			InitializeStats(stats.outcomes[p][u]);
+	}
+}
+
+void RecordRound(SimStats& stats, int player_points, int dealer_upcard, double net) {
+	if (net > 0)
+		stats.wins++;
+	else if (net < 0)
+		stats.losses++;
+	else stats.ties++;
+	RecordStat(stats.returns, net);
+
+	stats.bankroll += net;
+	if (stats.bankroll > stats.peak)
+		stats.peak = stats.bankroll;
+	double drawdown = stats.peak - stats.bankroll;
+	if (drawdown > stats.max_drawdown)
+		stats.max_drawdown = drawdown;
+	RecordValue(stats.bankrolls, llround(stats.bankroll));
+	RecordValue(stats.drawdowns, llround(drawdown));
+
+	if (player_points >= 4 && player_points < MATRIX_TOTALS && dealer_upcard >= 2 && dealer_upcard < MATRIX_UPCARDS)
+		RecordStat(stats.outcomes[player_points][dealer_upcard], net);
+}
+
+void RecordRound(RunningStats& stats, int, int, double net) {
+	RecordStat(stats, net);
+}
+
+void MergeSimStats(SimStats& into, const SimStats& from) {
+	into.wins += from.wins;
+	into.losses += from.losses;
+	into.ties += from.ties;
+	MergeStats(into.returns, from.returns);
+	MergeHistograms(into.bankrolls, from.bankrolls);
+	MergeHistograms(into.drawdowns, from.drawdowns);
+	if (from.max_drawdown > into.max_drawdown)
+		into.max_drawdown = from.max_drawdown;
+	for (int p = 0; p < MATRIX_TOTALS; p++) {
+		for (int u = 0; u < MATRIX_UPCARDS; u++)
+			MergeStats(into.outcomes[p][u], from.outcomes[p][u]);
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+/* Streaming statistics for simulation runs. Everything here takes the same memory
+* after a billion rounds as after one, and merges: give each thread its own
+* accumulators and add them together once the threads are done, no locking needed.
+*/
+
+#include <cstdint>
+
+/* RunningStats: count, mean and variance (Welford's method, which doesn't lose
+* precision the way summing squares does), plus the extremes.
+*/
+
+struct RunningStats {
+	long long	count;
+	double		mean;
+	double		m2;			// sum of squared differences from the mean
+	double		min, max;
+};
+
+void InitializeStats(RunningStats& stats);
+void RecordStat(RunningStats& stats, double x);
+void MergeStats(RunningStats& into, const RunningStats& from);
+double GetVariance(const RunningStats& stats);
+double GetStdDev(const RunningStats& stats);
+// half the width of the confidence interval on the mean; z = 1.96 for 95%
+double GetConfidence(const RunningStats& stats, double z = 1.96);
+
+/* Histogram: HDR-style log-linear buckets over the whole signed 64-bit range. Values
+* under HISTOGRAM_LINEAR get a bucket each; past that every power of two is split into
+* HISTOGRAM_LINEAR / 2 buckets, so any value is known to within 1.6%.
+*/
+
+#define HISTOGRAM_BITS		7
+#define HISTOGRAM_LINEAR	(1 << HISTOGRAM_BITS)
+#define HISTOGRAM_BUCKETS	(HISTOGRAM_LINEAR + (64 - HISTOGRAM_BITS) * (HISTOGRAM_LINEAR / 2))
+
+struct Histogram {
+	long long	count;
+	uint64_t	positive[HISTOGRAM_BUCKETS];	// zero goes in here
+	uint64_t	negative[HISTOGRAM_BUCKETS];	// by magnitude
+};
+
+void InitializeHistogram(Histogram& hist);
+void RecordValue(Histogram& hist, long long value);
+void MergeHistograms(Histogram& into, const Histogram& from);
+// the value percent% of the recorded values are at or below, to the histogram's precision
+long long GetPercentile(const Histogram& hist, double percent);
+
+/* SimStats: everything the simulator keeps about a run. */
+
+#define MATRIX_TOTALS	22		// the player's first two cards, 4 to 21
+#define MATRIX_UPCARDS	12		// the dealer's upcard, 2 to 11
+
+struct SimStats {
+	long long		wins, losses, ties;		// by round, counting all split hands together
+	RunningStats	returns;				// chips won or lost each round, betting one
+	// the bankroll is one long session starting from 0; these see it after every round
+	double			bankroll, peak;
+	Histogram		bankrolls;
+	Histogram		drawdowns;				// how far below the best bankroll so far
+	double			max_drawdown;
+	RunningStats	outcomes[MATRIX_TOTALS][MATRIX_UPCARDS];
+};
+
+void InitializeSimStats(SimStats& stats);
+void RecordRound(SimStats& stats, int player_points, int dealer_upcard, double net);
+// for runs that only want the return
+void RecordRound(RunningStats& stats, int player_points, int dealer_upcard, double net);
+// bankroll and peak stay with into; from's trajectory is a separate session
+void MergeSimStats(SimStats& into, const SimStats& from);
+#endif
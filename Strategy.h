@@ -0,0 +1,87 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+/* Basic strategy, for the simulator to play with. These are the usual multi-deck
+* charts, with the few H17 changes; insurance is never taken.
+*/
+
+#include "Rules.h"
+
+template <class Rules>
+Action BasicStrategy(const Round& round) {
+	const Hand& hand = round.hands[round.current].cards;
+	int up = GetCardPoints(round.dealer.cards[0]);	// 2 to 11
+	int points = GetPoints(hand);
+	bool soft = IsSoft(hand);
+	bool can_double = CanDouble<Rules>(round);
+
+	if (CanSplit<Rules>(round)) {
+		bool das = Rules::double_after_split;
+		bool split = false;
+		switch (GetCardPoints(hand.cards[0])) {
+		case 11:
+		case 8:
+			split = true;
+			break;
+		case 9:
+			split = up <= 9 && up != 7;
+			break;
+		case 7:
+			split = up <= 7;
+			break;
+		case 6:
+			split = up <= 6 && (das || up >= 3);
+			break;
+		case 4:
+			split = das && (up == 5 || up == 6);
+			break;
+		case 3:
+		case 2:
+			split = up <= 7 && (das || up >= 4);
+			break;
+		}
+		if (split)
+			return Split;
+	}
+
+	if (!soft && CanSurrender<Rules>(round)) {
+		if (points == 16 && up >= 9)
+			return Surrender;
+		if (points == 15 && (up == 10 || (up == 11 && Rules::dealer_hits_soft_17)))
+			return Surrender;
+	}
+
+	if (soft) {
+		switch (points) {
+		case 13:
+		case 14:
+			return (can_double && up >= 5 && up <= 6) ? Double : Hit;
+		case 15:
+		case 16:
+			return (can_double && up >= 4 && up <= 6) ? Double : Hit;
+		case 17:
+			return (can_double && up >= 3 && up <= 6) ? Double : Hit;
+		case 18:
+			if (up >= 3 && up <= 6)
+				return can_double ? Double : Stand;
+			return (up >= 9) ? Hit : Stand;
+		default:
+			return (points >= 19) ? Stand : Hit;
+		}
+	}
+
+	if (points <= 8)
+		return Hit;
+	if (points == 9)
+		return (can_double && up >= 3 && up <= 6) ? Double : Hit;
+	if (points == 10)
+		return (can_double && up <= 9) ? Double : Hit;
+	if (points == 11)
+		return (can_double && (up <= 10 || Rules::dealer_hits_soft_17)) ? Double : Hit;
+	if (points == 12)
+		return (up >= 4 && up <= 6) ? Stand : Hit;
+	if (points <= 16)
+		return (up <= 6) ? Stand : Hit;
+	return Stand;
+}
+#endif
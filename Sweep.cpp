@@ -0,0 +1,332 @@
+#include "Sweep.h"
+
+#include "Simulator.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+#define SWEEP_CACHE_VERSION	2		// bump when a change to the engine changes results
+
+struct SweepPoint {
+	int		num_decks;
+	double	penetration;
+	bool	h17;
+	int		pays, pays_per;
+	int		stands_on;
+};
+
+/* RULES */
+
+template <bool H17, int Pays, int Per, int StandsOn>
+struct GridRules : StandardRules {
+	static constexpr int  dealer_stands_on = StandsOn;
+	static constexpr bool dealer_hits_soft_17 = H17;
+	static constexpr int  blackjack_pays = Pays;
+	static constexpr int  blackjack_pays_per = Per;
+};
+
+// the sweepable values each need their own instantiation, so only these are allowed
+static const int SWEEP_PAYS[][2] = { { 3, 2 }, { 6, 5 }, { 1, 1 }, { 2, 1 } };
+#define NUM_SWEEP_PAYS	4
+#define MIN_STANDS_ON	16
+#define MAX_STANDS_ON	18
+
+template <bool H17, int Pays, int Per, class F>
+static void WithStandsOn(int stands_on, F& f) {
+	switch (stands_on) {
+	case 16: f(GridRules<H17, Pays, Per, 16>()); break;
+	case 17: f(GridRules<H17, Pays, Per, 17>()); break;
+	case 18: f(GridRules<H17, Pays, Per, 18>()); break;
+	}
+}
+
+template <bool H17, class F>
+static void WithPays(const SweepPoint& point, F& f) {
+	if (point.pays == 3 && point.pays_per == 2)
+		WithStandsOn<H17, 3, 2>(point.stands_on, f);
+	else if (point.pays == 6 && point.pays_per == 5)
+		WithStandsOn<H17, 6, 5>(point.stands_on, f);
+	else if (point.pays == 1 && point.pays_per == 1)
+		WithStandsOn<H17, 1, 1>(point.stands_on, f);
+	else if (point.pays == 2 && point.pays_per == 1)
+		WithStandsOn<H17, 2, 1>(point.stands_on, f);
+}
+
+// like CallWithRules, for a grid point
+template <class F>
+static void CallWithGridRules(const SweepPoint& point, F f) {
+	if (point.h17)
+		WithPays<true>(point, f);
+	else WithPays<false>(point, f);
+}
+
+/* GRID */
+
+void InitializeSweepGrid(SweepGrid& grid) {
+	const int decks[] = { 1, 2, 6, 8 };
+	for (int i = 0; i < 4; i++)
+		grid.decks[i] = decks[i];
+	grid.num_decks = 4;
+	grid.penetrations[0] = 0.75;
+	grid.num_penetrations = 1;
+	grid.h17[0] = false;
+	grid.h17[1] = true;
+	grid.num_h17 = 2;
+	for (int i = 0; i < 2; i++) {
+		grid.pays[i][0] = SWEEP_PAYS[i][0];
+		grid.pays[i][1] = SWEEP_PAYS[i][1];
+	}
+	grid.num_pays = 2;
+	grid.stands_on[0] = 17;
+	grid.num_stands_on = 1;
+}
+
+static bool KnownPays(int pays, int per) {
+	for (int i = 0; i < NUM_SWEEP_PAYS; i++) {
+		if (SWEEP_PAYS[i][0] == pays && SWEEP_PAYS[i][1] == per)
+			return true;
+	}
+	return false;
+}
+
+// reads the comma separated values after name=; false if any of them is out of range
+static bool ParseValues(SweepGrid& grid, const string& name, const string& values) {
+	SweepGrid parsed = grid;
+	int count = 0;
+	stringstream in(values);
+	string value;
+	while (getline(in, value, ',')) {
+		if (count == MAX_SWEEP_VALUES)
+			return false;
+		if (name == "decks") {
+			int decks = atoi(value.c_str());
+			if (decks < 1 || decks > MAX_DECKS)
+				return false;
+			parsed.decks[count] = decks;
+		}
+		else if (name == "pen") {
+			double pen = atof(value.c_str());
+			if (pen < 0.1 || pen > 0.95)
+				return false;
+			parsed.penetrations[count] = pen;
+		}
+		else if (name == "h17") {
+			if (value != "0" && value != "1")
+				return false;
+			parsed.h17[count] = value == "1";
+		}
+		else if (name == "pays") {
+			int pays = 0, per = 0;
+			if (sscanf(value.c_str(), "%d:%d", &pays, &per) != 2 || !KnownPays(pays, per))
+				return false;
+			parsed.pays[count][0] = pays;
+			parsed.pays[count][1] = per;
+		}
+		else if (name == "stand") {
+			int stands_on = atoi(value.c_str());
+			if (stands_on < MIN_STANDS_ON || stands_on > MAX_STANDS_ON)
+				return false;
+			parsed.stands_on[count] = stands_on;
+		}
+		else return false;
+		count++;
+	}
+	if (count == 0)
+		return false;
+	if (name == "decks") parsed.num_decks = count;
+	else if (name == "pen") parsed.num_penetrations = count;
+	else if (name == "h17") parsed.num_h17 = count;
+	else if (name == "pays") parsed.num_pays = count;
+	else parsed.num_stands_on = count;
+	grid = parsed;
+	return true;
+}
+
+bool ParseSweepOption(SweepGrid& grid, const char* option) {
+	const char* equals = strchr(option, '=');
+	if (equals == NULL)
+		return false;
+	return ParseValues(grid, string(option, equals - option), string(equals + 1));
+}
+
+static vector<SweepPoint> ListPoints(const SweepGrid& grid) {
+	vector<SweepPoint> points;
+	for (int d = 0; d < grid.num_decks; d++)
+	for (int p = 0; p < grid.num_penetrations; p++)
+	for (int h = 0; h < grid.num_h17; h++)
+	for (int b = 0; b < grid.num_pays; b++)
+	for (int s = 0; s < grid.num_stands_on; s++) {
+		SweepPoint point;
+		point.num_decks = grid.decks[d];
+		point.penetration = grid.penetrations[p];
+		point.h17 = grid.h17[h];
+		point.pays = grid.pays[b][0];
+		point.pays_per = grid.pays[b][1];
+		point.stands_on = grid.stands_on[s];
+		points.push_back(point);
+	}
+	return points;
+}
+
+/* CACHE */
+
+// everything that goes into a point's result, spelled out; the file name is its hash
+static string CacheKey(const SweepPoint& point, long long num_rounds, uint64_t seed) {
+	stringstream key;
+	key << "v" << SWEEP_CACHE_VERSION << " strategy=basic decks=" << point.num_decks
+		<< " pen=" << point.penetration << " h17=" << point.h17
+		<< " pays=" << point.pays << ":" << point.pays_per << " stand=" << point.stands_on
+		<< " rounds=" << num_rounds << " seed=" << seed << " chunks=" << SWEEP_CHUNKS;
+	return key.str();
+}
+
+// 64-bit FNV-1a
+static uint64_t HashKey(const string& key) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < key.size(); i++) {
+		hash ^= (uint8_t)key[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static string CachePath(const char* dir, const string& key) {
+	stringstream path;
+	path << dir << "/" << hex << setw(16) << setfill('0') << HashKey(key) << ".txt";
+	return path.str();
+}
+
+// the key is stored too, so a hash collision reads as a miss rather than a wrong answer
+static bool LoadCached(const char* dir, const string& key, RunningStats& stats) {
+	ifstream in(CachePath(dir, key));
+	string stored;
+	if (!getline(in, stored) || stored != key)
+		return false;
+	in >> stats.count >> stats.mean >> stats.m2 >> stats.min >> stats.max;
+	return (bool)in;
+}
+
+// written next to the real file and renamed over it, like a shard checkpoint
+static void SaveCached(const char* dir, const string& key, const RunningStats& stats) {
+	string path = CachePath(dir, key);
+	string temp = path + ".tmp";
+	{
+		ofstream out(temp);
+		out << key << endl << setprecision(17) << stats.count << " " << stats.mean << " "
+			<< stats.m2 << " " << stats.min << " " << stats.max << endl;
+		if (!out)
+			return;
+	}
+	error_code error;
+	fs::rename(temp, path, error);
+}
+
+/* RUNNING */
+
+// the pieces all of a run's points were split into; the last thread to finish a point saves it
+struct SweepQueue {
+	vector<SweepPoint>		points;
+	vector<int>				todo;		// indexes into points
+	vector<RunningStats>	chunks;		// SWEEP_CHUNKS per point in todo
+	atomic<int>*			remaining;	// chunks still running, per point in todo
+	atomic<long long>		next;
+	long long				num_rounds;
+	uint64_t				seed;
+	const char*				cache_dir;
+};
+
+static void FinishPoint(SweepQueue& queue, int t, RunningStats& result) {
+	InitializeStats(result);
+	for (int c = 0; c < SWEEP_CHUNKS; c++)
+		MergeStats(result, queue.chunks[t * SWEEP_CHUNKS + c]);
+	const SweepPoint& point = queue.points[queue.todo[t]];
+	SaveCached(queue.cache_dir, CacheKey(point, queue.num_rounds, queue.seed), result);
+}
+
+static void SweepWorker(SweepQueue* queue, vector<RunningStats>* results) {
+	Shoe* shoe = new Shoe;
+	long long num_tasks = (long long)queue->todo.size() * SWEEP_CHUNKS;
+	for (long long task = queue->next++; task < num_tasks; task = queue->next++) {
+		int t = (int)(task / SWEEP_CHUNKS);
+		int c = (int)(task % SWEEP_CHUNKS);
+		const SweepPoint& point = queue->points[queue->todo[t]];
+		long long rounds = queue->num_rounds / SWEEP_CHUNKS + (c < queue->num_rounds % SWEEP_CHUNKS ? 1 : 0);
+		RunningStats& stats = queue->chunks[task];
+		InitializeStats(stats);
+		InitializeShoe(*shoe, queue->seed + c * SEED_STRIDE, point.num_decks, point.penetration);
+		CallWithGridRules(point, [&](auto rules) {
+			Simulate<decltype(rules)>(stats, *shoe, rounds);
+		});
+		if (--queue->remaining[t] == 0)
+			FinishPoint(*queue, t, (*results)[queue->todo[t]]);
+	}
+	delete shoe;
+}
+
+static void PrintSweep(const vector<SweepPoint>& points, const vector<RunningStats>& results, const vector<bool>& cached) {
+	cout << "decks    pen  dealer   pays  house edge" << endl;
+	cout << fixed;
+	for (size_t i = 0; i < points.size(); i++) {
+		const SweepPoint& point = points[i];
+		stringstream pays;
+		pays << point.pays << ":" << point.pays_per;
+		cout << setw(5) << point.num_decks << setw(7) << setprecision(2) << point.penetration
+			<< "  " << (point.h17 ? "H" : "S") << point.stands_on
+			<< setw(10) << pays.str() << setw(11) << setprecision(3) << -100.0 * results[i].mean
+			<< "% +/- " << 100.0 * GetConfidence(results[i]) << "%"
+			<< (cached[i] ? "  (cached)" : "") << endl;
+	}
+	cout.unsetf(ios::floatfield);
+	cout << setprecision(6);
+}
+
+void RunSweep(const char* cache_dir, const SweepGrid& grid, long long num_rounds, uint64_t seed) {
+	if (num_rounds <= 0)
+		return;
+	error_code error;
+	fs::create_directories(cache_dir, error);
+
+	SweepQueue queue;
+	queue.points = ListPoints(grid);
+	queue.num_rounds = num_rounds;
+	queue.seed = seed;
+	queue.cache_dir = cache_dir;
+	queue.next = 0;
+	vector<RunningStats> results(queue.points.size());
+	vector<bool> cached(queue.points.size());
+	for (size_t i = 0; i < queue.points.size(); i++) {
+		cached[i] = LoadCached(cache_dir, CacheKey(queue.points[i], num_rounds, seed), results[i]);
+		if (!cached[i])
+			queue.todo.push_back((int)i);
+	}
+	cout << queue.points.size() << " points, " << queue.points.size() - queue.todo.size() << " cached" << endl;
+
+	queue.chunks.resize(queue.todo.size() * SWEEP_CHUNKS);
+	queue.remaining = new atomic<int>[queue.todo.size()];
+	for (size_t t = 0; t < queue.todo.size(); t++)
+		queue.remaining[t] = SWEEP_CHUNKS;
+	int num_threads = (int)thread::hardware_concurrency();
+	if (num_threads < 1)
+		num_threads = 1;
+	vector<thread> threads;
+	for (int t = 0; t < num_threads; t++)
+		threads.push_back(thread(SweepWorker, &queue, &results));
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	delete[] queue.remaining;
+
+	PrintSweep(queue.points, results, cached);
+}
@@ -0,0 +1,42 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/* Parameter sweeps: the house edge over every combination of deck count, penetration,
+* soft 17, blackjack payout and the dealer's stand threshold, everything else as in
+* StandardRules. Each grid point is split into SWEEP_CHUNKS pieces and all the pieces
+* go in one queue that every core pulls from, so a grid with a few slow points (one
+* deck, deep penetration) doesn't leave cores idle at the end.
+*
+* Finished points are cached in a directory, one small text file per point named after
+* a hash of the rules, strategy, rounds and seed, so rerunning a sweep with a point or
+* two added only plays the new ones.
+*/
+
+#include <cstdint>
+
+#define MAX_SWEEP_VALUES	8		// per parameter
+#define SWEEP_CHUNKS		16		// pieces each grid point is split into
+
+struct SweepGrid {
+	int		decks[MAX_SWEEP_VALUES];
+	int		num_decks;
+	double	penetrations[MAX_SWEEP_VALUES];
+	int		num_penetrations;
+	bool	h17[MAX_SWEEP_VALUES];
+	int		num_h17;
+	int		pays[MAX_SWEEP_VALUES][2];		// blackjack pays pays[i][0] : pays[i][1]
+	int		num_pays;
+	int		stands_on[MAX_SWEEP_VALUES];
+	int		num_stands_on;
+};
+
+// 1, 2, 6 and 8 decks at 75%, S17 and H17, 3:2 and 6:5, dealer stands on 17
+void InitializeSweepGrid(SweepGrid& grid);
+
+// replaces one parameter's values from e.g. "decks=1,2,6", "pen=0.5,0.75", "h17=0,1",
+// "pays=3:2,6:5,1:1" or "stand=16,17,18"; false if it isn't one of those
+bool ParseSweepOption(SweepGrid& grid, const char* option);
+
+// plays num_rounds at every grid point that isn't already in cache_dir, then prints them all
+void RunSweep(const char* cache_dir, const SweepGrid& grid, long long num_rounds, uint64_t seed);
+#endif
@@ -0,0 +1,39 @@
+#include "TableFlow.h"
+
+#include <cstddef>
+
+void InitializeTable(Table& table, TimerWheel& wheel, double bet, uint64_t dealer_turn_ticks, uint64_t dealer_draw_ticks) {
+	FillDeck(table.deck);
+	ShuffleDeck(table.deck);
+	table.bet = bet;
+	table.wheel = &wheel;
+	table.dealer_turn_ticks = dealer_turn_ticks;
+	table.dealer_draw_ticks = dealer_draw_ticks;
+	table.timer.next = NULL;
+	table.timer.link = NULL;
+	table.waiting = nullptr;
+	table.input = InputDeal;
+	table.events = 0;
+	table.flow.handle = nullptr;
+	table.wins = 0;
+	table.losses = 0;
+	table.ties = 0;
+	table.chips = 0;
+}
+
+void SendInput(Table& table, TableInput input) {
+	if (!table.waiting)
+		return;
+	std::coroutine_handle<> waiting = table.waiting;
+	table.waiting = nullptr;
+	table.input = input;
+	waiting.resume();
+}
+
+void DestroyTable(Table& table) {
+	RemoveTimer(*table.wheel, table.timer);
+	table.waiting = nullptr;
+	if (table.flow.handle)
+		table.flow.handle.destroy();
+	table.flow.handle = nullptr;
+}
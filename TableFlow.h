@@ -0,0 +1,135 @@
+#ifndef TABLEFLOW_H
+#define TABLEFLOW_H
+
+/* A table's round flow as a coroutine: deal, insurance, the player's decisions, the
+* dealer drawing with pauses in between, then waiting to deal again, written top to
+* bottom the way a round goes. The coroutine sleeps on a TimerWheel or waits for
+* input and is only resumed when one of those happens, so a table nobody is playing
+* at costs nothing per tick, however many tables there are.
+*
+* Nothing here knows about keys or sounds: the caller turns key presses into
+* TableInputs with SendInput, and reads what happened back out of events.
+*/
+
+#include "Rules.h"
+#include "TimerWheel.h"
+
+#include <coroutine>
+#include <exception>
+
+// the first five are the Actions, in the same order
+enum TableInput { InputHit, InputStand, InputDouble, InputSplit, InputSurrender, InputYes, InputNo, InputDeal };
+
+// set in Table::events as they happen, for the caller to clear once it's handled them
+#define TABLE_DEALT_CARD	0x01
+#define TABLE_DEALER_TURN	0x02
+#define TABLE_ROUND_OVER	0x04
+
+// the coroutine type: starts straight away and runs until it first waits
+struct TableTask {
+	struct promise_type {
+		TableTask get_return_object() { return TableTask{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+	std::coroutine_handle<promise_type> handle;
+};
+
+struct Table {
+	Deck					deck;
+	Round					round;
+	double					bet;
+	TimerWheel*				wheel;
+	uint64_t				dealer_turn_ticks;		// pause before the dealer's first card
+	uint64_t				dealer_draw_ticks;		// and between cards after that
+	Timer					timer;					// a table only ever sleeps on one thing
+	std::coroutine_handle<>	waiting;				// the flow, while it waits for input
+	TableInput				input;
+	int						events;
+	TableTask				flow;
+	// the score, for the caller to keep; here so a snapshot takes it along
+	int						wins;
+	int						losses;
+	int						ties;
+	double					chips;
+};
+
+// everything but the flow; the deck is filled and shuffled
+void InitializeTable(Table& table, TimerWheel& wheel, double bet, uint64_t dealer_turn_ticks, uint64_t dealer_draw_ticks);
+// hands the input to the flow if it's waiting for some; otherwise it's dropped, like a
+// key pressed while the dealer is drawing
+void SendInput(Table& table, TableInput input);
+// takes the flow off the wheel and frees it
+void DestroyTable(Table& table);
+
+struct InputAwaiter {
+	Table&	table;
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> waiter) { table.waiting = waiter; }
+	TableInput await_resume() const { return table.input; }
+};
+
+inline InputAwaiter WaitForInput(Table& table) {
+	return InputAwaiter{ table };
+}
+
+/* The flow picks up from whatever the round's state says, so a table restored from a
+* snapshot (see TableSnapshot.h) carries on where it was saved. When resuming, events
+* already raised before the snapshot aren't raised again (the snapshot kept any that
+* weren't handled), and sleep_ticks is what's left of the dealer's pause.
+*/
+template <class Rules>
+TableTask PlayTable(Table& table, bool resuming, uint64_t sleep_ticks) {
+	Round& round = table.round;
+	GameState resumed_state = round.state;
+	for (;;) {
+		if (round.state == InsuranceOffer) {
+			TableInput answer = co_await WaitForInput(table);
+			while (answer != InputYes && answer != InputNo)
+				answer = co_await WaitForInput(table);
+			TakeInsurance<Rules>(round, answer == InputYes);
+		}
+		while (round.state == PlayerTurn) {
+			TableInput input = co_await WaitForInput(table);
+			if (input > InputSurrender)
+				continue;
+			int cards_before = table.deck.next_card;
+			ApplyAction<Rules>(round, table.deck, (Action)input);
+			if (table.deck.next_card != cards_before)
+				table.events |= TABLE_DEALT_CARD;
+		}
+		if (round.state == DealerTurn) {
+			if (sleep_ticks == 0) {
+				table.events |= TABLE_DEALER_TURN;
+				sleep_ticks = table.dealer_turn_ticks;
+			}
+			co_await SleepFor(*table.wheel, table.timer, sleep_ticks);
+			sleep_ticks = 0;
+			while (DealerShouldHit<Rules>(round.dealer)) {
+				AddCardToHand(round.dealer, DealCard(table.deck));
+				table.events |= TABLE_DEALT_CARD;
+				co_await SleepFor(*table.wheel, table.timer, table.dealer_draw_ticks);
+			}
+			round.state = GameOver;
+		}
+		// rounds can also end on a natural or with every hand bust, without the dealer playing;
+		// a round that was already over when the table was saved has been scored
+		if (!resuming || resumed_state != GameOver)
+			table.events |= TABLE_ROUND_OVER;
+		resuming = false;
+		while (co_await WaitForInput(table) != InputDeal) {}
+		ShuffleDeck(table.deck);
+		StartRound<Rules>(round, table.deck, table.bet);
+	}
+}
+
+// starts the table's flow, which deals the first round
+template <class Rules>
+void StartTable(Table& table) {
+	StartRound<Rules>(table.round, table.deck, table.bet);
+	table.flow = PlayTable<Rules>(table, false, 0);
+}
+#endif
@@ -0,0 +1,163 @@
+#include "TableSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static bool SaveHand(TableSnapshot& snapshot, int& used, int i, const Hand& hand, int flags) {
+	if (used + hand.num_cards > SNAPSHOT_CARDS)
+		return false;
+	SnapshotHand& out = snapshot.hands[i];
+	out.first = (uint8_t)used;
+	out.num_cards = (uint8_t)hand.num_cards;
+	out.flags = (uint8_t)flags;
+	for (int c = 0; c < hand.num_cards; c++)
+		snapshot.cards[used + c] = (uint8_t)GetCardCode(hand.cards[c]);
+	used += hand.num_cards;
+	return true;
+}
+
+static void RestoreHand(const TableSnapshot& snapshot, int i, Hand& hand) {
+	const SnapshotHand& in = snapshot.hands[i];
+	hand.num_cards = in.num_cards;
+	for (int c = 0; c < in.num_cards; c++)
+		hand.cards[c] = CardFromCode(snapshot.cards[in.first + c]);
+}
+
+bool SaveTable(const Table& table, TableSnapshot& snapshot) {
+	// zeroed first so the unused parts of the arrays, and the padding, are always the same
+	memset(&snapshot, 0, sizeof(snapshot));
+	snapshot.magic = SNAPSHOT_MAGIC;
+	snapshot.version = SNAPSHOT_VERSION;
+	snapshot.size = sizeof(snapshot);
+
+	const Deck& deck = table.deck;
+	snapshot.rng = deck.rng;
+	snapshot.deck_cards = (uint16_t)deck.num_cards;
+	snapshot.next_card = (uint16_t)deck.next_card;
+	snapshot.round_start = (uint16_t)deck.round_start;
+	for (int i = 0; i < deck.num_cards; i++)
+		snapshot.deck[i] = (uint8_t)GetCardCode(deck.cards[i]);
+
+	const Round& round = table.round;
+	int used = 0;
+	for (int i = 0; i < round.num_hands; i++) {
+		const PlayerHand& hand = round.hands[i];
+		int flags = (hand.split_aces ? SNAPSHOT_SPLIT_ACES : 0) | (hand.doubled ? SNAPSHOT_DOUBLED : 0)
+			| (hand.surrendered ? SNAPSHOT_SURRENDERED : 0) | (hand.done ? SNAPSHOT_DONE : 0);
+		if (!SaveHand(snapshot, used, i, hand.cards, flags))
+			return false;
+		snapshot.hand_bets[i] = hand.bet;
+	}
+	if (!SaveHand(snapshot, used, SNAPSHOT_DEALER, round.dealer, 0))
+		return false;
+	snapshot.bet = table.bet;
+	snapshot.insurance_bet = round.insurance_bet;
+	snapshot.num_hands = (uint8_t)round.num_hands;
+	snapshot.current = (uint8_t)round.current;
+	snapshot.state = (uint8_t)round.state;
+	snapshot.events = (uint8_t)table.events;
+
+	// a waiting timer is the dealer pausing; it's saved as what's left, since the
+	// wheel it's restored onto starts its count over
+	if (table.timer.link != NULL)
+		snapshot.sleep_ticks = (uint32_t)(table.timer.due - table.wheel->now);
+	snapshot.dealer_turn_ticks = (uint32_t)table.dealer_turn_ticks;
+	snapshot.dealer_draw_ticks = (uint32_t)table.dealer_draw_ticks;
+	snapshot.wins = table.wins;
+	snapshot.losses = table.losses;
+	snapshot.ties = table.ties;
+	snapshot.chips = table.chips;
+	return true;
+}
+
+bool CheckSnapshot(const TableSnapshot& snapshot) {
+	if (snapshot.magic != SNAPSHOT_MAGIC || snapshot.version != SNAPSHOT_VERSION || snapshot.size != sizeof(snapshot))
+		return false;
+	// the deck: whole decks, and dealt no further than it goes
+	if (snapshot.deck_cards < 52 || snapshot.deck_cards > MAX_DECKS * 52 || snapshot.deck_cards % 52 != 0
+		|| snapshot.next_card > snapshot.deck_cards || snapshot.round_start > snapshot.next_card)
+		return false;
+	// the round: insurance is only offered before any splitting, the hand being played
+	// isn't finished, and only the dealer's pause leaves time on the timer
+	if (snapshot.num_hands < 1 || snapshot.num_hands > MAX_HANDS || snapshot.current >= snapshot.num_hands
+		|| snapshot.state > GameOver)
+		return false;
+	if (snapshot.state == InsuranceOffer && (snapshot.num_hands != 1 || snapshot.current != 0))
+		return false;
+	if (snapshot.state == PlayerTurn && (snapshot.hands[snapshot.current].flags & SNAPSHOT_DONE) != 0)
+		return false;
+	if (snapshot.sleep_ticks != 0 && snapshot.state != DealerTurn)
+		return false;
+	// every hand in play has two cards at least, and no more than a Hand holds
+	for (int i = 0; i <= MAX_HANDS; i++) {
+		const SnapshotHand& hand = snapshot.hands[i];
+		if (i != SNAPSHOT_DEALER && i >= snapshot.num_hands)
+			continue;
+		if (hand.num_cards < 2 || hand.num_cards > 52 || hand.first + hand.num_cards > SNAPSHOT_CARDS)
+			return false;
+	}
+	for (int i = 0; i < snapshot.deck_cards; i++) {
+		if (snapshot.deck[i] >= 52)
+			return false;
+	}
+	for (int i = 0; i < SNAPSHOT_CARDS; i++) {
+		if (snapshot.cards[i] >= 52)
+			return false;
+	}
+	return true;
+}
+
+void RestoreRound(const TableSnapshot& snapshot, Round& round, Deck& deck) {
+	deck.rng = snapshot.rng;
+	deck.num_cards = snapshot.deck_cards;
+	deck.next_card = snapshot.next_card;
+	deck.round_start = snapshot.round_start;
+	for (int i = 0; i < snapshot.deck_cards; i++)
+		deck.cards[i] = CardFromCode(snapshot.deck[i]);
+
+	round.num_hands = snapshot.num_hands;
+	round.current = snapshot.current;
+	round.state = (GameState)snapshot.state;
+	round.insurance_bet = snapshot.insurance_bet;
+	for (int i = 0; i < snapshot.num_hands; i++) {
+		PlayerHand& hand = round.hands[i];
+		int flags = snapshot.hands[i].flags;
+		RestoreHand(snapshot, i, hand.cards);
+		hand.bet = snapshot.hand_bets[i];
+		hand.split_aces = (flags & SNAPSHOT_SPLIT_ACES) != 0;
+		hand.doubled = (flags & SNAPSHOT_DOUBLED) != 0;
+		hand.surrendered = (flags & SNAPSHOT_SURRENDERED) != 0;
+		hand.done = (flags & SNAPSHOT_DONE) != 0;
+	}
+	RestoreHand(snapshot, SNAPSHOT_DEALER, round.dealer);
+}
+
+/* FILES */
+
+bool LoadSnapshotFile(const char* path, TableSnapshot& snapshot) {
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+		return false;
+	bool ok = fread(&snapshot, sizeof(snapshot), 1, f) == 1;
+	fclose(f);
+	return ok && CheckSnapshot(snapshot);
+}
+
+// written next to the real file and renamed over it, like a shard checkpoint
+bool SaveSnapshotFile(const char* path, const TableSnapshot& snapshot) {
+	string temp = string(path) + ".tmp";
+	FILE* f = fopen(temp.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	bool ok = fwrite(&snapshot, sizeof(snapshot), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	error_code error;
+	if (ok)
+		fs::rename(temp, path, error);
+	return ok && !error;
+}
@@ -0,0 +1,92 @@
+#ifndef TABLESNAPSHOT_H
+#define TABLESNAPSHOT_H
+
+/* Everything about a table in one flat struct of a few hundred bytes: the deck's order,
+* how far into it we are and its random number generator, the hands, the state, how
+* long is left on the dealer's pause and the score. There are no pointers in it, so
+* copying one is a memcpy and it can go to disk as is.
+*
+* That makes forking cheap: a search that wants to try hitting and standing from here
+* takes one snapshot, then restores it into a scratch Round and Deck (RestoreRound) for
+* each branch and plays that on with ApplyAction. RestoreTable brings back a live table,
+* flow and all, for carrying on after a restart.
+*
+* Cards are kept as their codes, a byte each, and the hands' cards share one pool.
+*/
+
+#include "TableFlow.h"
+
+#include <cstdint>
+
+#define SNAPSHOT_MAGIC		0x534A4254u		// "TBJS"
+#define SNAPSHOT_VERSION	2
+// every card needs at least a point, so a hand busts by its 22nd card and the dealer
+// stops by their 18th: MAX_HANDS * 22 + 18 cards at most
+#define SNAPSHOT_CARDS		(MAX_HANDS * 22 + 18)
+#define SNAPSHOT_DEALER		MAX_HANDS		// the dealer's entry in hands
+
+#define SNAPSHOT_SPLIT_ACES		0x01
+#define SNAPSHOT_DOUBLED		0x02
+#define SNAPSHOT_SURRENDERED	0x04
+#define SNAPSHOT_DONE			0x08
+
+struct SnapshotHand {
+	uint8_t	first;		// in cards
+	uint8_t	num_cards;
+	uint8_t	flags;
+};
+
+struct TableSnapshot {
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		size;
+	Rng				rng;
+	uint16_t		deck_cards;
+	uint16_t		next_card;
+	uint16_t		round_start;
+	uint8_t			deck[MAX_DECKS * 52];
+	double			bet;
+	double			hand_bets[MAX_HANDS];
+	double			insurance_bet;
+	SnapshotHand	hands[MAX_HANDS + 1];
+	uint8_t			num_hands;
+	uint8_t			current;
+	uint8_t			state;			// a GameState
+	uint8_t			events;
+	uint8_t			cards[SNAPSHOT_CARDS];
+	uint32_t		sleep_ticks;	// left of the dealer's pause; 0 if they aren't pausing
+	uint32_t		dealer_turn_ticks;
+	uint32_t		dealer_draw_ticks;
+	int32_t			wins;
+	int32_t			losses;
+	int32_t			ties;
+	double			chips;
+};
+
+// false if the table doesn't fit, which a real round never does
+bool SaveTable(const Table& table, TableSnapshot& snapshot);
+// false if it isn't a snapshot this build wrote
+bool CheckSnapshot(const TableSnapshot& snapshot);
+// just the round and deck, for looking ahead; no flow, no timers
+void RestoreRound(const TableSnapshot& snapshot, Round& round, Deck& deck);
+
+// the file is the struct as is, so only the same build of the program can read it back
+bool SaveSnapshotFile(const char* path, const TableSnapshot& snapshot);
+bool LoadSnapshotFile(const char* path, TableSnapshot& snapshot);
+
+// the table should be initialized and not started, or destroyed; the snapshot must
+// come from a table playing the same Rules
+template <class Rules>
+void RestoreTable(Table& table, const TableSnapshot& snapshot) {
+	RestoreRound(snapshot, table.round, table.deck);
+	table.bet = snapshot.bet;
+	table.dealer_turn_ticks = snapshot.dealer_turn_ticks;
+	table.dealer_draw_ticks = snapshot.dealer_draw_ticks;
+	table.events = snapshot.events;
+	table.wins = snapshot.wins;
+	table.losses = snapshot.losses;
+	table.ties = snapshot.ties;
+	table.chips = snapshot.chips;
+	table.flow = PlayTable<Rules>(table, true, snapshot.sleep_ticks);
+}
+#endif
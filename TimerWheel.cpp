@@ -0,0 +1,103 @@
+#include "TimerWheel.h"
+
+#include <cstddef>
+
+void InitializeTimerWheel(TimerWheel& wheel) {
+	wheel.now = 0;
+	wheel.count = 0;
+	for (int level = 0; level < WHEEL_LEVELS; level++) {
+		for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+			wheel.slots[level][slot] = NULL;
+	}
+}
+
+static void LinkTimer(Timer*& head, Timer& timer) {
+	timer.next = head;
+	if (head != NULL)
+		head->link = &timer.next;
+	timer.link = &head;
+	head = &timer;
+}
+
+static void UnlinkTimer(Timer& timer) {
+	*timer.link = timer.next;
+	if (timer.next != NULL)
+		timer.next->link = timer.link;
+	timer.next = NULL;
+	timer.link = NULL;
+}
+
+// the lowest level whose reach covers the wait, and the slot there its due tick lands in
+static void PlaceTimer(TimerWheel& wheel, Timer& timer) {
+	uint64_t wait = timer.due - wheel.now;
+	uint64_t due = timer.due;
+	int level = 0;
+	while (level < WHEEL_LEVELS - 1 && wait >= (1ull << (WHEEL_BITS * (level + 1))))
+		level++;
+	if (wait >= (1ull << (WHEEL_BITS * WHEEL_LEVELS)))
+		due = wheel.now + (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;	// parks it; it's put back when that comes round
+	int slot = (int)((due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	LinkTimer(wheel.slots[level][slot], timer);
+}
+
+void AddTimer(TimerWheel& wheel, Timer& timer, uint64_t ticks, std::coroutine_handle<> waiter) {
+	if (ticks == 0)
+		ticks = 1;
+	timer.due = wheel.now + ticks;
+	timer.waiter = waiter;
+	PlaceTimer(wheel, timer);
+	wheel.count++;
+}
+
+void RemoveTimer(TimerWheel& wheel, Timer& timer) {
+	if (timer.link == NULL)
+		return;
+	UnlinkTimer(timer);
+	wheel.count--;
+}
+
+// moves a higher level's slot down now that the levels below have come round to it
+static void Cascade(TimerWheel& wheel, int level) {
+	int slot = (int)((wheel.now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	Timer* timer = wheel.slots[level][slot];
+	wheel.slots[level][slot] = NULL;
+	while (timer != NULL) {
+		Timer* next = timer->next;
+		PlaceTimer(wheel, *timer);
+		timer = next;
+	}
+	if (slot == 0 && level + 1 < WHEEL_LEVELS)
+		Cascade(wheel, level + 1);
+}
+
+void AdvanceTimerWheel(TimerWheel& wheel, uint64_t to) {
+	while (wheel.now < to) {
+		if (wheel.count == 0) {
+			wheel.now = to;		// nothing to find on the way
+			return;
+		}
+		wheel.now++;
+		int slot = (int)(wheel.now & (WHEEL_SLOTS - 1));
+		if (slot == 0)
+			Cascade(wheel, 1);
+		// take the whole slot first: what gets resumed may well add timers of its own
+		// and may remove the next timer in it, which the link to next takes care of
+		Timer* timer = wheel.slots[0][slot];
+		wheel.slots[0][slot] = NULL;
+		while (timer != NULL) {
+			Timer* next = timer->next;
+			if (next != NULL)
+				next->link = &next;
+			timer->next = NULL;
+			timer->link = NULL;
+			if (timer->due > wheel.now) {
+				PlaceTimer(wheel, *timer);		// a long wait going round again
+			}
+			else {
+				wheel.count--;
+				timer->waiter.resume();
+			}
+			timer = next;
+		}
+	}
+}
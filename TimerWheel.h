@@ -0,0 +1,56 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+/* A hierarchical timer wheel (Varghese and Lauck): WHEEL_LEVELS rings of WHEEL_SLOTS
+* lists. Level 0 holds timers due within WHEEL_SLOTS ticks, one slot per tick; each
+* level up covers WHEEL_SLOTS times as long per slot, and its timers drop down a level
+* when the one below comes round to them. Adding, removing and firing a timer are all
+* constant time however many are waiting, and a tick with nothing due touches one slot.
+*
+* Timers are intrusive, so the wheel never allocates: whoever waits owns the Timer
+* (usually an awaiter in a coroutine frame) and must keep it alive until it fires or
+* is removed. What a tick is worth is up to the caller.
+*/
+
+#include <coroutine>
+#include <cstdint>
+
+#define WHEEL_BITS		6
+#define WHEEL_SLOTS		(1 << WHEEL_BITS)
+#define WHEEL_LEVELS	4		// up to WHEEL_SLOTS^4 ticks out; longer waits go round again
+
+struct Timer {
+	Timer*					next;
+	Timer**					link;		// whatever points at this timer; NULL when it isn't waiting
+	uint64_t				due;		// in ticks
+	std::coroutine_handle<>	waiter;		// resumed when it fires
+};
+
+struct TimerWheel {
+	uint64_t	now;		// ticks done so far
+	int			count;		// timers waiting
+	Timer*		slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+void InitializeTimerWheel(TimerWheel& wheel);
+// resumes waiter after ticks more ticks; zero counts as one, since this tick is already under way
+void AddTimer(TimerWheel& wheel, Timer& timer, uint64_t ticks, std::coroutine_handle<> waiter);
+void RemoveTimer(TimerWheel& wheel, Timer& timer);	// fine if it isn't waiting
+// runs the wheel up to tick to, resuming whatever comes due in the order it was due
+void AdvanceTimerWheel(TimerWheel& wheel, uint64_t to);
+
+// for co_await SleepFor(wheel, timer, ticks)
+struct TimerAwaiter {
+	TimerWheel&	wheel;
+	Timer&		timer;
+	uint64_t	ticks;
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> waiter) { AddTimer(wheel, timer, ticks, waiter); }
+	void await_resume() const {}
+};
+
+inline TimerAwaiter SleepFor(TimerWheel& wheel, Timer& timer, uint64_t ticks) {
+	return TimerAwaiter{ wheel, timer, ticks };
+}
+#endif